@@ -36,15 +36,26 @@
 #define LEFT_HAND   "ArS02"
 #define ADDRESS     RIGHT_HAND
 
+/* Both hands listen here for cues sent without ACK */
+#define BROADCAST   "ArS00"
+
+/* Payload width. Set to 1 for an MPU started with --legacy-feedback,
+ * which sends static payloads of this width. Otherwise payloads are
+ * dynamic and every ACK carries telemetry. */
+#define PAYLOAD_SIZE  5
+#define MAX_PAYLOAD   32
+
+#define DEFAULT_TIMEOUT 500
+
 class Motor
 {
   enum MotorStatus{OFF, ON};
-  const int TIMEOUT = 500;
   
   private:
     bool status;
     int pin;
     unsigned long activeOn;
+    unsigned long timeout;
 
   public:
     /**
@@ -58,6 +69,8 @@ class Motor
     {
       pin = pinNumber;
       pinMode(pin, OUTPUT);
+      status = OFF;
+      timeout = DEFAULT_TIMEOUT;
     }
 
     /**
@@ -65,9 +78,25 @@ class Motor
      */
     void turnOn()
     {
-      digitalWrite(pin, HIGH);
+      turnOn(DEFAULT_TIMEOUT, 0);
+    }
+
+    /**
+     * Turn On Motor
+     * 
+     * @param duration    on time in milliseconds
+     * @param intensity   PWM duty, 0 for full power
+     */
+    void turnOn(unsigned long duration, byte intensity)
+    {
+      if (intensity)
+        analogWrite(pin, intensity);
+      else
+        digitalWrite(pin, HIGH);
+
       status = ON;
       activeOn = millis();
+      timeout = duration;
     }
 
     /**
@@ -95,7 +124,7 @@ class Motor
      */
     void timeoutControl()
     {
-      if ((millis() - activeOn) > TIMEOUT)
+      if (status == ON && (millis() - activeOn) > timeout)
       {
         turnOff();
       }
@@ -108,15 +137,68 @@ class Motor
 #define ALL_MOTOR_OFF   0xC0
 #define ALL_MOTOR_ON    0xD0
 
+/* Packed feedback frame, version 1:
+ *   [0] PACKED_FEEDBACK
+ *   [1] motor mask, bit 0-7
+ *   [2] motor mask, bit 8-9 in bit 0-1, PACKED_SET in bit 7
+ *   [3] duration in 10 ms units, 0 for the default timeout
+ *   [4] intensity, 0 for full power
+ *   [5] sequence number, only with dynamic payloads
+ * A frame with the sequence number of the last one is a resend whose
+ * ACK got lost, and is dropped.
+ */
+#define PACKED_FEEDBACK 0xE1
+#define PACKED_SET      0x80
+
+/* Telemetry frame, loaded as the ACK payload of the next frame:
+ *   [0] TELEMETRY
+ *   [1] sequence number of the last feedback frame
+ *   [2] feedback frames missed, rolling count
+ *   [3] supply voltage in 20 mV units
+ *   [4] motor state, bit 0-7
+ *   [5] motor state, bit 8-9 in bit 0-1
+ */
+#define TELEMETRY         0xE2
+#define TELEMETRY_SIZE    6
+#define BATTERY_INTERVAL  1000
+
+/* Link configuration frame:
+ *   [0] LINK_CONFIG
+ *   [1] data rate, 0 for 1 Mbps, 1 for 2 Mbps
+ * The module goes back to 1 Mbps after LINK_FALLBACK_TIMEOUT without
+ * traffic, so a lost link always recovers.
+ */
+#define LINK_CONFIG           0xF1
+#define LINK_FALLBACK_TIMEOUT 1000
+
+/* Channel hop frame:
+ *   [0] CHANNEL_HOP
+ *   [1] RF channel
+ * The module goes back to HOME_CHANNEL after CHANNEL_FALLBACK_TIMEOUT
+ * without traffic, so a restarted MPU always finds it.
+ */
+#define CHANNEL_HOP              0xF2
+#define HOME_CHANNEL             76
+#define CHANNEL_FALLBACK_TIMEOUT 10000
+
 RF24 radio(19, 10);
-byte data;
+byte data[MAX_PAYLOAD];
 Motor motor[MOTOR_COUNT];
 int motorPin[MOTOR_COUNT] = {1, 0, 2, 3, 4, 5, 6, 7, 8, 9};
+rf24_datarate_e dataRate = RF24_1MBPS;
+byte channel = HOME_CHANNEL;
+unsigned long lastReceived;
+byte sequence;
+bool sequenceValid = false;
+byte missed = 0;
+unsigned int battery;
+unsigned long batteryReadAt;
 
 void setup()
 {
   /* Initialize RF Address */
   byte address[6] = ADDRESS;
+  byte broadcast[6] = BROADCAST;
 
   /* Initialize serial communication */
   Serial.begin(9600);
@@ -126,8 +208,17 @@ void setup()
   Serial.println("Initializing radio...");
   radio.begin();
   radio.setPALevel(RF24_PA_LOW);
-  radio.setPayloadSize(1);
+  radio.setPayloadSize(PAYLOAD_SIZE);
+  if (PAYLOAD_SIZE > 1)
+  {
+    radio.enableDynamicPayloads();
+    radio.enableAckPayload();
+  }
+  radio.setDataRate(dataRate);
+  radio.setChannel(channel);
   radio.setAutoAck(1);
+  radio.setAutoAck(0, false);
+  radio.openReadingPipe(0, broadcast);
   radio.openReadingPipe(1, address);
   radio.startListening();
   radio.printDetails();
@@ -139,20 +230,73 @@ void setup()
     motor[i].init(motorPin[i]);
   }
   allMotorOff();
+
+  battery = readBattery();
+  batteryReadAt = millis();
+  loadTelemetry();
 }
 
 void loop()
 {
+  byte pipe;
+  bool acknowledged = false;
+
   if (radio.available())
   {
-    while (radio.available())
+    while (radio.available(&pipe))
     { 
-      radio.read(&data, 1);
+      byte len = PAYLOAD_SIZE > 1 ? radio.getDynamicPayloadSize() : PAYLOAD_SIZE;
+
+      if (len > MAX_PAYLOAD)
+        len = MAX_PAYLOAD;
+
+      radio.read(data, len);
+
+      // Broadcasts are not acknowledged, the MPU cannot tell we heard them
+      if (pipe != 0)
+      {
+        lastReceived = millis();
+        acknowledged = true;
+      }
 
       Serial.print("Data received: ");
-      Serial.println(data, HEX);
-      parseCommand(data);
+      Serial.println(data[0], HEX);
+
+      if (len >= 5 && data[0] == PACKED_FEEDBACK)
+      {
+        if (len < 6 || acceptSequence(data[5]))
+          parsePacked(data);
+      }
+      else if (len >= 2 && data[0] == LINK_CONFIG)
+        setLinkRate(data[1] ? RF24_2MBPS : RF24_1MBPS);
+      else if (len >= 2 && data[0] == CHANNEL_HOP)
+        setChannel(data[1]);
+      else
+        parseCommand(data[0]);
     }
+
+    // Ready for the ACK of the next frame
+    if (acknowledged)
+      loadTelemetry();
+  }
+
+  // The ADC reference needs time to settle, keep it out of the receive path
+  if (millis() - batteryReadAt > BATTERY_INTERVAL)
+  {
+    battery = readBattery();
+    batteryReadAt = millis();
+  }
+
+  // Return to the default rate when the MPU no longer reaches us
+  if (dataRate != RF24_1MBPS && millis() - lastReceived > LINK_FALLBACK_TIMEOUT)
+  {
+    setLinkRate(RF24_1MBPS);
+  }
+
+  // Return to the home channel when the MPU may have restarted
+  if (channel != HOME_CHANNEL && millis() - lastReceived > CHANNEL_FALLBACK_TIMEOUT)
+  {
+    setChannel(HOME_CHANNEL);
   }
 
   // Run Motor Timeout Controller
@@ -193,6 +337,149 @@ void parseCommand(byte message)
    }
 }
 
+/**
+ * Parse packed command
+ * 
+ * @param   frame   packed feedback frame
+ */
+void parsePacked(byte *frame)
+{
+  unsigned int mask = frame[1] | ((frame[2] & 0x03) << 8);
+  bool on = frame[2] & PACKED_SET;
+  unsigned long duration = frame[3] ? frame[3] * 10UL : DEFAULT_TIMEOUT;
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if (!(mask & (1 << i)))
+      continue;
+
+    if (on)
+      motor[i].turnOn(duration, frame[4]);
+    else
+      motor[i].turnOff();
+  }
+}
+
+/**
+ * Check sequence number of a feedback frame
+ * 
+ * @param   number   sequence number
+ * @return           false for a resent frame
+ */
+bool acceptSequence(byte number)
+{
+  if (sequenceValid && number == sequence)
+    return false;
+
+  if (sequenceValid)
+    missed += (byte) (number - sequence - 1);
+
+  sequence = number;
+  sequenceValid = true;
+
+  return true;
+}
+
+/**
+ * Load telemetry as the next ACK payload
+ */
+void loadTelemetry()
+{
+  if (PAYLOAD_SIZE <= 1)
+    return;
+
+  unsigned int motors = 0;
+  byte frame[TELEMETRY_SIZE];
+
+  for (int i = 0; i < MOTOR_COUNT; i++)
+  {
+    if (motor[i].getStatus())
+      motors |= 1 << i;
+  }
+
+  frame[0] = TELEMETRY;
+  frame[1] = sequence;
+  frame[2] = missed;
+  frame[3] = battery / 20 > 255 ? 255 : battery / 20;
+  frame[4] = motors & 0xFF;
+  frame[5] = (motors >> 8) & 0x03;
+
+  // Every received frame takes the one loaded before it
+  radio.writeAckPayload(1, frame, TELEMETRY_SIZE);
+}
+
+/**
+ * Read supply voltage
+ *
+ * Measures the internal 1.1 V reference against AVcc.
+ * 
+ * @return  voltage in millivolts
+ */
+unsigned int readBattery()
+{
+#if defined(__AVR_ATmega32U4__)
+  ADMUX = _BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+#else
+  ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
+#endif
+
+  delay(2);
+  ADCSRA |= _BV(ADSC);
+  while (bit_is_set(ADCSRA, ADSC));
+
+  unsigned int result = ADCL;
+  result |= ADCH << 8;
+
+  return result ? 1125300L / result : 0;
+}
+
+/**
+ * Change air data rate
+ * 
+ * @param   rate   new data rate
+ */
+void setLinkRate(rf24_datarate_e rate)
+{
+  if (rate == dataRate)
+    return;
+
+  // Let the auto acknowledgement leave at the old rate first
+  delay(1);
+
+  radio.stopListening();
+  radio.setDataRate(rate);
+  radio.startListening();
+
+  dataRate = rate;
+  lastReceived = millis();
+
+  Serial.println(rate == RF24_2MBPS ? "Link rate: 2 Mbps" : "Link rate: 1 Mbps");
+}
+
+/**
+ * Change RF channel
+ * 
+ * @param   number   new channel
+ */
+void setChannel(byte number)
+{
+  if (number == channel || number > 125)
+    return;
+
+  // Let the auto acknowledgement leave on the old channel first
+  delay(1);
+
+  radio.stopListening();
+  radio.setChannel(number);
+  radio.startListening();
+
+  channel = number;
+  lastReceived = millis();
+
+  Serial.print("Channel: ");
+  Serial.println(channel);
+}
+
 /**
  * Turn Off All Motor
  */
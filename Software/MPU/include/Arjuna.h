@@ -37,9 +37,12 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <thread>
+#include <cstring>
 
 #include "Setup.h"
+#include "Scheduler.h"
+#include "TempoMap.h"
+#include "PitchSet.h"
 #include "MidiFile.h"
 #include "FingerData.h"
 
@@ -47,11 +50,15 @@
 #define		PLAY_SONG_BUTTON	'B'
 #define		EVALUATOR_BUTTON	'C'
 #define 	STOP_BUTTON			'D'
+#define		SKIP_BUTTON			'#'
 
 #define		BOTH_HANDS_MODE_BUTTON	'1'
 #define		RIGHT_HAND_MODE_BUTTON	'2'
 #define 	LEFT_HAND_MODE_BUTTON 	'3'
 
+#define		MAX_FRAME_SIZE			16
+#define		QUEUE_WINDOW			500000
+
 struct Key
 {
 	int track;
@@ -59,6 +66,42 @@ struct Key
 	unsigned char finger;
 };
 
+/**
+ * One chord of the evaluated track, a run of the chord key array
+ */
+struct ChordEntry
+{
+	int offset;					/* First key of the chord */
+	int count;					/* Number of keys */
+	int event;					/* Plan index of the first chord event */
+};
+
+/**
+ * The notes of a chord still waiting to be played, with the finger and
+ * track of every pitch
+ */
+struct Chord
+{
+	PitchSet pending;
+	unsigned char finger[PITCH_COUNT];
+	unsigned char track[PITCH_COUNT];
+};
+
+/**
+ * A precompiled playback event. The playback plan is a contiguous array of
+ * these records, one per MIDI event of the played track.
+ */
+struct PlaybackEvent
+{
+	long long time;				/* Event time in microseconds */
+	unsigned char message[3];	/* MIDI message bytes */
+	unsigned char size;			/* MIDI message size, 0 if nothing to send */
+	bool noteOn;				/* Note on event, needs feedback */
+	unsigned char hand;			/* Hand module receiving the feedback */
+	char finger;				/* Finger data of a note on */
+	unsigned short motors;		/* Vibrator mask of the finger */
+};
+
 enum PlayMode {BOTH_HANDS, LEFT_HAND, RIGHT_HAND};
 enum MPUOperation {PLAYER, EVALUATOR};
 
@@ -110,7 +153,8 @@ void printSongList(std::ifstream *songList);
 /**
  * Select Song
  *
- * This method will ask the user to choose from opened song list
+ * This method will ask the user to choose from opened song list. The
+ * number is confirmed with the select button, or by holding its last digit.
  * 
  * @param  songList song list handler
  * @return          song name
@@ -137,9 +181,41 @@ void startMPA(Container *container, std::string songPath, MPUOperation operation
  * @param  container hardware handler
  * @param  midi 	 MIDI file handler
  * @param  finger 	 finger data handler
+ * @param  tempoMap  song tempo map
  * @param  mode 	 selected play mode
  */
-void play(Container *container, MidiFile *midi, FingerData *finger, PlayMode mode);
+void play(Container *container, MidiFile *midi, FingerData *finger, TempoMap *tempoMap, PlayMode mode);
+
+/**
+ * Get Playback Frame
+ *
+ * This function collects the MIDI messages of the events sharing the
+ * timestamp of plan[i] into one frame, up to MAX_FRAME_SIZE messages
+ *
+ * @param  plan   	playback plan
+ * @param  i      	index of the first event
+ * @param  frame  	frame container, MAX_FRAME_SIZE * 3 bytes
+ * @param  sizes  	message sizes container, MAX_FRAME_SIZE elements
+ * @param  count  	number of messages in the frame
+ * @return        	index of the first event after the frame
+ */
+unsigned int getFrame(std::vector<PlaybackEvent> *plan, unsigned int i, unsigned char *frame, size_t *sizes, size_t *count);
+
+/**
+ * Compile Playback Plan
+ *
+ * This function flattens the played track into a contiguous array of
+ * events with absolute times, raw MIDI bytes and precomputed feedback
+ * payloads, so the playback loop does not touch the MIDI file at all.
+ * The plan has one record per MIDI event, in the same order.
+ *
+ * @param midi     MIDI file handler
+ * @param finger   finger data handler
+ * @param tempoMap song tempo map
+ * @param mode     selected play mode
+ * @param plan     plan container
+ */
+void compilePlaybackPlan(MidiFile *midi, FingerData *finger, TempoMap *tempoMap, PlayMode mode, std::vector<PlaybackEvent> *plan);
 
 /**
  * Song Evaluator
@@ -149,60 +225,75 @@ void play(Container *container, MidiFile *midi, FingerData *finger, PlayMode mod
  * @param container handware handler
  * @param midi      MIDI file handler
  * @param finger    finger data handler
+ * @param tempoMap  song tempo map
  * @param mode      selected play mode
  */
-void evaluate(Container *container, MidiFile *midi, FingerData *finger, PlayMode mode);
+void evaluate(Container *container, MidiFile *midi, FingerData *finger, TempoMap *tempoMap, PlayMode mode);
 
 /**
- * Get Unison Note
+ * Compile Chord Index
  *
- * This function groups note played at the same time
- * 
- * @param  midi MIDI file handler
- * @param  m    MIDI file index
- * @param  t    MIDI track number
- * @param  keys Keys container
- * @return      status
+ * This function groups the note ons of the evaluated track into chords,
+ * a new chord starting at every event with a non-zero delta tick. The keys
+ * of all chords are stored back to back, so the evaluator steps through
+ * the song without touching the MIDI file.
+ *
+ * @param midi   MIDI file handler
+ * @param plan   playback plan of the track
+ * @param mode   selected play mode
+ * @param chords chord index container
+ * @param keys   chord keys container
  */
-bool getUnisonNote(MidiFile *midi, int *m, int t, std::vector<Key> *keys);
+void compileChordIndex(MidiFile *midi, std::vector<PlaybackEvent> *plan, PlayMode mode, std::vector<ChordEntry> *chords, std::vector<Key> *keys);
 
 /**
- * Get Unison Finger
- * This function groups finger played at the same time
+ * Build Chord
+ *
+ * This function turns a group of keys into a pitch set for matching
  * 
- * @param finger finger data handler
- * @param f      finger data index
- * @param keys   Keys container
+ * @param keys   first key of the chord
+ * @param count  number of keys
+ * @param chord  chord container
  */
-void getUnisonFinger(FingerData *finger, std::vector<char> *f, std::vector<Key> *keys);
+void buildChord(const Key *keys, int count, Chord *chord);
 
 /**
  * Get MIDI Input
  * 
+ * This function blocks on the MIDI input until a note arrives or a keypad
+ * command interrupts the wait
+ * 
  * @param io       MIDI IO handler
- * @param expected number of expected input
+ * @param chord    expected notes
+ * @param keys     keypad subscription
+ * @param plan     playback plan of the track
+ * @param m        plan index of the current chord
+ * @return         STOP_BUTTON or SKIP_BUTTON if interrupted, 0 otherwise
  */
-void getInputAndEvaluate(Container *container, std::vector<Key> keys, char *keypress, MidiFile *midi, int m, int t);
+char getInputAndEvaluate(Container *container, Chord *chord, KeySubscription *keys, std::vector<PlaybackEvent> *plan, int m);
 
 /**
  * Compare MIDI Input with MIDI Data
  *
- * @param  rf 	Trasceiver handler
- * @param  keys MIDI Data
- * @param  note MIDI Input
- * @return      Compare result
+ * A matched note is removed from the chord. On a wrong note, only the
+ * finger of the nearest expected note gets a feedback.
+ *
+ * @param  radio 	radio service handler
+ * @param  chord 	MIDI Data
+ * @param  note 	MIDI Input
+ * @return      	Compare result
  */
-bool compare(ORF24 *rf, std::vector<Key> *keys, unsigned char note);
+bool compare(RadioService *radio, Chord *chord, unsigned char note);
 
 /**
  * Get Play Mode
  *
  * This function ask the user to select the play mode
  * 
- * @param  keypad 	keypad handler
+ * @param  input 	input service handler
  * @return          play mode
  */
-PlayMode getPlayMode(WiringPiKeypad *keypad);
+PlayMode getPlayMode(InputService *input);
 
 /**
  * Set Play Mode
@@ -215,35 +306,28 @@ PlayMode getPlayMode(WiringPiKeypad *keypad);
 void setPlayMode(MidiFile *midi, PlayMode mode);
 
 /**
- * Get Tempo in Second Per Tick
- * 	
- * @param e   	MidiEvent
- * @param tpq 	tick peq quarter
- * @param spt 	second per tick
- */
-void getTempoSPT(MidiEvent e, int tpq, double *spt);
-
-/**
- * Send MIDI Message
+ * Send Feedback to Hand Module
  *
- * This method will form a MIDI message container and send it to MIDI output port
+ * This method queues a payload for the radio service to send to hand module
  * 
- * @param io MIDI i/O port
- * @param e  MIDI event
+ * @param radio 	radio service handler
+ * @param f  		finger data
+ * @param t  		active track
+ * @param right 	turn on right vibrator. If false, then turn on left vibrator
  */
-void sendMidiMessage(MidiIO *io, MidiEvent e);
+void sendFeedback(RadioService *radio, char f, int t, bool right);
 
 /**
- * Send Feedback to Hand Module
+ * Get Feedback Motor
  *
- * This method use the radio transceiver to send payload to hand module
+ * This method finds the hand module vibrator of a finger
  * 
- * @param rf 		radio handler
- * @param f  		finger data
- * @param t  		active track
- * @param right 	turn on right vibrator. If false, then turn on left vibrator
+ * @param  f  		finger data
+ * @param  t  		active track
+ * @param  right 	right vibrator. If false, then left vibrator
+ * @return       	motor number, -1 if the finger is unknown
  */
-void sendFeedback(ORF24 *rf, char f, int t, bool right);
+int getFeedbackMotor(char f, int t, bool right);
 
 /**
  * Inverse Finger Number
@@ -257,15 +341,46 @@ void sendFeedback(ORF24 *rf, char f, int t, bool right);
 unsigned char inverse(unsigned char finger);
 
 /**
- * Keypad Handler
+ * Wait For Stop Button
+ *
+ * Sleeps on the keypad subscription until the deadline, returning early
+ * when the stop button is pressed. A deadline in the past only drains the
+ * events already queued.
+ * 
+ * @param  keys     	keypad subscription
+ * @param  deadline 	CLOCK_MONOTONIC deadline in microseconds
+ * @return          	true if the stop button was pressed
+ */
+bool waitForStop(KeySubscription *keys, long long deadline);
+
+/**
+ * Get Evaluator Command
+ *
+ * Drains the keypad subscription without blocking. Pressing stop ends the
+ * session, holding skip moves on one chord now and one more per repeat.
+ * 
+ * @param  keys 	keypad subscription
+ * @return      	STOP_BUTTON, SKIP_BUTTON, or 0 if there is no command
+ */
+char getCommand(KeySubscription *keys);
+
+/**
+ * Check Evaluator Command
+ * 
+ * @param  event 	key event
+ * @return       	true if the event is a stop or skip command
+ */
+bool isCommand(const struct KeyEvent *event);
+
+/**
+ * Interrupt On Command
  *
- * This function should be called in separate thread to wair for user action
- * while doing other operation
+ * Key callback that wakes the evaluator from its MIDI input wait on a
+ * stop or skip command. Runs on the input thread.
  * 
- * @param keypad     keypad handler
- * @param keypress   keypress handler
- * @param terminator keypad terminator
+ * @param event     key event
+ * @param io        MIDI IO handler
  */
-void keypadHandler(WiringPiKeypad *keypad, char *keypress, bool *terminator);
+void interruptOnCommand(const struct KeyEvent *event, void *io);
 
 #endif
\ No newline at end of file
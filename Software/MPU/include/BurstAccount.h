@@ -0,0 +1,244 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _BURST_ACCOUNT_H_
+#define _BURST_ACCOUNT_H_
+
+/**
+ * BurstAccount Class Interface
+ *
+ * Keeps track of which payloads of a TX FIFO burst were acknowledged.
+ * TX_DS is a single sticky flag, so one observation may stand for several
+ * completions. Counting one completion per observation is always safe,
+ * payloads leave the FIFO in order, but after such a merge the head of
+ * the FIFO is no longer known. A retry limit hit in that state cannot be
+ * blamed on one payload: every unresolved payload is sent again instead,
+ * one at a time so the rest of the burst is accounted exactly.
+ */
+class BurstAccount
+{
+private:
+
+	/**
+	 * Number of payloads in the burst
+	 */
+	int count;
+
+	/**
+	 * Payloads written to the FIFO
+	 */
+	int loaded;
+
+	/**
+	 * Payloads with a known result
+	 */
+	int done;
+
+	/**
+	 * Acknowledged payloads
+	 */
+	int acked;
+
+	/**
+	 * Payloads resent because a failure could not be attributed
+	 */
+	int resent;
+
+	/**
+	 * Payloads allowed in the FIFO at once
+	 */
+	int depth;
+
+	/**
+	 * Completions may have merged since the last exact point
+	 */
+	bool uncertain;
+
+	/**
+	 * Per payload acknowledgement, may be null
+	 */
+	bool *results;
+
+	/**
+	 * Record a result
+	 *
+	 * @param success 	true if acknowledged
+	 */
+	void resolve(bool success)
+	{
+		if (results)
+			results[done] = success;
+
+		if (success)
+			acked++;
+
+		done++;
+	}
+
+public:
+
+	/**
+	 * BurstAccount Class Constructor
+	 *
+	 * @param _count   	number of payloads
+	 * @param _results 	per payload acknowledgement, may be null
+	 * @param _depth   	payloads allowed in the FIFO at once
+	 */
+	BurstAccount(int _count, bool *_results, int _depth)
+		: count(_count), loaded(0), done(0), acked(0), resent(0),
+		  depth(_depth < 1 ? 1 : _depth), uncertain(false), results(_results) { }
+
+	/**
+	 * Check whether another payload fits in the FIFO
+	 *
+	 * @return  true if next() may be called
+	 */
+	bool canLoad(void)
+	{
+		return loaded < count && loaded - done < depth;
+	}
+
+	/**
+	 * Take the next payload to load
+	 *
+	 * @return  payload index
+	 */
+	int next(void)
+	{
+		return loaded++;
+	}
+
+	/**
+	 * TX_DS was observed and cleared
+	 *
+	 * At least the oldest payload in flight was acknowledged.
+	 */
+	void onSent(void)
+	{
+		if (done >= loaded)
+			return;
+
+		if (loaded - done > 1)
+			uncertain = true;
+
+		resolve(true);
+	}
+
+	/**
+	 * MAX_RT was observed, the FIFO has been flushed
+	 */
+	void onFailed(void)
+	{
+		if (done >= loaded)
+			return;
+
+		if (!uncertain)
+		{
+			resolve(false);
+		}
+		else
+		{
+			resent += loaded - done;
+			depth = 1;
+		}
+
+		loaded = done;
+		uncertain = false;
+	}
+
+	/**
+	 * The TX FIFO was seen empty
+	 *
+	 * Nothing is left behind a failure, so every payload in flight made it.
+	 */
+	void onEmpty(void)
+	{
+		while (done < loaded)
+			resolve(true);
+
+		uncertain = false;
+	}
+
+	/**
+	 * Give up on the payloads without a result
+	 */
+	void finish(void)
+	{
+		loaded = count;
+
+		while (done < count)
+			resolve(false);
+	}
+
+	/**
+	 * Check whether every payload has a result
+	 *
+	 * @return  true if done
+	 */
+	bool isDone(void)
+	{
+		return done >= count;
+	}
+
+	/**
+	 * Check whether payloads are waiting for a result
+	 *
+	 * @return  true if any payload is in the FIFO
+	 */
+	bool inFlight(void)
+	{
+		return done < loaded;
+	}
+
+	/**
+	 * Get acknowledged payload count
+	 *
+	 * @return  acknowledged payloads
+	 */
+	int getAcked(void)
+	{
+		return acked;
+	}
+
+	/**
+	 * Get resent payload count
+	 *
+	 * @return  payloads sent again after an unattributable failure
+	 */
+	int getResent(void)
+	{
+		return resent;
+	}
+};
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * Evdev Keyboard Keypad Library
+ *
+ * Copyright (c) 2015 Ilham Imaduddin <ilham.imaduddin@mail.ugm.ac.id>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _EVDEV_KEYPAD_H_
+#define _EVDEV_KEYPAD_H_
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <linux/input.h>
+
+#include "Keypad.h"
+
+#define		EVDEV_DIR			"/dev/input"
+#define		MAX_EVDEV_DEVICES	8
+#define		EVDEV_POLL_TIMEOUT	100
+
+class EvdevKeypad : public Keypad
+{
+protected:
+	std::string devicePath;
+	int epollFd;
+	int deviceFd[MAX_EVDEV_DEVICES];
+	std::string deviceName[MAX_EVDEV_DEVICES];
+	int deviceCount;
+	bool grab;
+	char keymap[KEY_CNT];
+	struct key pressed[MAX_HELD_KEYS];
+	int pressedCount;
+	long long changeTime;
+	bool changePending;
+
+	char getSymbol(struct key k);
+	bool isKeypad(int fd);
+	bool addDevice(const std::string &path);
+	void removeDevice(int fd);
+	bool readChange(int fd);
+	bool press(int code, bool down);
+
+public:
+	EvdevKeypad(void);
+	EvdevKeypad(const std::string &path);
+	~EvdevKeypad();
+	bool begin(void);
+	void setGrab(bool enable);
+	void mapKey(int code, char symbol);
+	int getDeviceCount(void);
+	bool getEvent(struct KeyEvent *event, const std::atomic<bool> *terminator);
+	void printDetails(void);
+};
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _GPIO_LINES_H_
+#define _GPIO_LINES_H_
+
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#define		GPIO_CHIP			"/dev/gpiochip0"
+#define		GPIO_CONSUMER		"arjuna"
+#define		MAX_GPIO_LINES		8
+#define		GPIO_EVENT_BATCH	16
+
+/**
+ * GpioLines Class Interface
+ *
+ * A group of lines requested from the Linux GPIO character device. All
+ * lines of the group are read or written with a single ioctl, and input
+ * lines can report their edges through the request file descriptor with
+ * kernel timestamps. Needs the v2 uAPI of Linux 5.10, every request fails
+ * on older headers so callers fall back to wiringPi.
+ */
+class GpioLines
+{
+private:
+
+	/**
+	 * Line request file descriptor
+	 */
+	int fd;
+
+	/**
+	 * Number of lines in the group
+	 */
+	int count;
+
+	/**
+	 * Request lines
+	 *
+	 * @param  chip    	GPIO chip device
+	 * @param  offsets 	line offsets on the chip
+	 * @param  n       	number of lines
+	 * @param  flags   	GPIO_V2_LINE_FLAG_* flags
+	 * @param  values  	initial output values, bit n for line n
+	 * @return         	status
+	 */
+	bool request(const char *chip, const int *offsets, int n, unsigned long long flags, unsigned long long values);
+
+public:
+
+	/**
+	 * GpioLines Class Constructor
+	 */
+	GpioLines();
+
+	/**
+	 * GpioLines Class Destructor
+	 */
+	~GpioLines();
+
+	/**
+	 * Request input lines
+	 *
+	 * @param  chip    	GPIO chip device
+	 * @param  offsets 	line offsets on the chip
+	 * @param  n       	number of lines
+	 * @param  pullUp  	enable the pull-up bias
+	 * @param  edges   	report both edges
+	 * @return         	status
+	 */
+	bool requestInput(const char *chip, const int *offsets, int n, bool pullUp, bool edges);
+
+	/**
+	 * Request output lines
+	 *
+	 * @param  chip      	GPIO chip device
+	 * @param  offsets   	line offsets on the chip
+	 * @param  n         	number of lines
+	 * @param  openDrain 	only drive the lines low, a high line floats
+	 * @param  values    	initial values, bit n for line n
+	 * @return           	status
+	 */
+	bool requestOutput(const char *chip, const int *offsets, int n, bool openDrain, unsigned long long values);
+
+	/**
+	 * Release the lines
+	 */
+	void release(void);
+
+	/**
+	 * Check whether lines are requested
+	 *
+	 * @return  true if requested
+	 */
+	bool isOpen(void);
+
+	/**
+	 * Read all lines
+	 *
+	 * @param  values 	values container, bit n for line n
+	 * @return        	status
+	 */
+	bool getValues(unsigned long long *values);
+
+	/**
+	 * Write lines
+	 *
+	 * @param  values 	values, bit n for line n
+	 * @param  mask   	lines to write, bit n for line n
+	 * @return        	status
+	 */
+	bool setValues(unsigned long long values, unsigned long long mask);
+
+	/**
+	 * Wait for edges
+	 *
+	 * Every queued edge is consumed.
+	 *
+	 * @param  timeout 	timeout in milliseconds, negative to wait forever
+	 * @param  time    	CLOCK_MONOTONIC time of the last edge in microseconds
+	 * @return         	number of edges, 0 on timeout, -1 on error
+	 */
+	int waitEdges(int timeout, long long *time);
+};
+
+#endif
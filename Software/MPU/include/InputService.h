@@ -0,0 +1,266 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _INPUT_SERVICE_H_
+#define _INPUT_SERVICE_H_
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "Keypad.h"
+#include "SpscQueue.h"
+
+#define		KEY_QUEUE_SIZE		32
+#define		MAX_SUBSCRIBERS		4
+
+/**
+ * Key event callback
+ *
+ * Runs on the input thread right after the event is queued, so it must not
+ * block. Use it to wake a consumer that sleeps somewhere else.
+ */
+typedef void (*KeyCallback)(const struct KeyEvent *event, void *userData);
+
+/**
+ * KeySubscription Class Interface
+ *
+ * One consumer's view of the keypad. Every subscription gets its own copy of
+ * each key event, so a consumer can never steal or miss a keypress meant for
+ * another one.
+ */
+class KeySubscription
+{
+	friend class InputService;
+
+private:
+
+	/**
+	 * Events waiting for the consumer
+	 */
+	SpscQueue<struct KeyEvent, KEY_QUEUE_SIZE> queue;
+
+	/**
+	 * Wait lock
+	 */
+	std::mutex waitMutex;
+
+	/**
+	 * Signals a queued event
+	 */
+	std::condition_variable ready;
+
+	/**
+	 * Subscription is receiving events
+	 */
+	std::atomic<bool> active;
+
+	/**
+	 * Wake callback
+	 */
+	KeyCallback callback;
+
+	/**
+	 * Callback argument
+	 */
+	void *userData;
+
+	/**
+	 * Events dropped on a full queue
+	 */
+	std::atomic<unsigned long> dropped;
+
+	/**
+	 * Running flag of the owning service
+	 */
+	const std::atomic<bool> *serviceRunning;
+
+	/**
+	 * Queue event and wake the consumer
+	 *
+	 * @param event 	key event
+	 */
+	void publish(const struct KeyEvent *event);
+
+	/**
+	 * Wake the consumer without an event
+	 */
+	void wake(void);
+
+public:
+
+	/**
+	 * KeySubscription Class Constructor
+	 */
+	KeySubscription();
+
+	/**
+	 * Take the next event without blocking
+	 *
+	 * @param  event 	event container
+	 * @return       	false if no event is queued
+	 */
+	bool poll(struct KeyEvent *event);
+
+	/**
+	 * Wait for the next event
+	 *
+	 * @param  event    	event container
+	 * @param  deadline 	CLOCK_MONOTONIC deadline in microseconds, negative to wait forever
+	 * @return          	false if the deadline passed or the service stopped first
+	 */
+	bool wait(struct KeyEvent *event, long long deadline);
+
+	/**
+	 * Wait for a key press
+	 *
+	 * @param  key      	key container
+	 * @param  deadline 	CLOCK_MONOTONIC deadline in microseconds, negative to wait forever
+	 * @return          	false if the deadline passed or the service stopped first
+	 */
+	bool waitKey(char *key, long long deadline);
+
+	/**
+	 * Get dropped event count
+	 *
+	 * @return  events lost on a full queue
+	 */
+	unsigned long getDroppedCount(void);
+};
+
+/**
+ * InputService Class Interface
+ *
+ * InputService owns the keypad and scans it on one long-lived thread. Key
+ * presses, releases, long presses, repeats and chords are timestamped and
+ * handed to every active subscription, so the menu, the player and the
+ * evaluator no longer spawn their own scanner threads or share a bare
+ * keypress variable.
+ */
+class InputService
+{
+private:
+
+	/**
+	 * Keypad handler
+	 */
+	Keypad *keypad;
+
+	/**
+	 * Subscription slots
+	 */
+	KeySubscription subscriptions[MAX_SUBSCRIBERS];
+
+	/**
+	 * Serializes subscribe and unsubscribe
+	 */
+	std::mutex subscribeMutex;
+
+	/**
+	 * Input thread
+	 */
+	std::thread worker;
+
+	/**
+	 * Input thread should keep running
+	 */
+	std::atomic<bool> running;
+
+	/**
+	 * Input thread routine
+	 */
+	void run(void);
+
+public:
+
+	/**
+	 * InputService Class Constructor
+	 *
+	 * @param _keypad 	initialized keypad
+	 */
+	InputService(Keypad *_keypad);
+
+	/**
+	 * InputService Class Destructor
+	 */
+	~InputService();
+
+	/**
+	 * Start input thread
+	 */
+	void start(void);
+
+	/**
+	 * Stop input thread
+	 *
+	 * Consumers waiting on a subscription are woken up.
+	 */
+	void stop(void);
+
+	/**
+	 * Subscribe to key events
+	 *
+	 * Only events that happen after this call are delivered.
+	 *
+	 * @param  callback 	optional wake callback, run on the input thread
+	 * @param  userData 	callback argument
+	 * @return          	subscription, or null if every slot is taken
+	 */
+	KeySubscription *subscribe(KeyCallback callback = NULL, void *userData = NULL);
+
+	/**
+	 * Release subscription
+	 *
+	 * @param subscription 	subscription to release
+	 */
+	void unsubscribe(KeySubscription *subscription);
+
+	/**
+	 * Wait for the next key press
+	 *
+	 * @return  pressed key, 0 if the service stopped
+	 */
+	char getKey(void);
+
+	/**
+	 * Get monotonic timestamp
+	 *
+	 * @return  CLOCK_MONOTONIC time in microseconds
+	 */
+	static long long timestamp(void);
+};
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * Keypad Input Interface
+ *
+ * Copyright (c) 2015 Ilham Imaduddin <ilham.imaduddin@mail.ugm.ac.id>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _KEYPAD_H_
+#define _KEYPAD_H_
+
+#include <atomic>
+#include <ctime>
+
+#define		MAX_HELD_KEYS		2
+#define		LONG_PRESS_DELAY	600
+#define		REPEAT_INTERVAL		150
+
+struct key
+{
+	int row;
+	int column;
+};
+
+enum KeyEventType
+{
+	KEYPAD_DOWN,			/* First key pressed */
+	KEYPAD_UP,				/* Key released */
+	KEYPAD_LONG_PRESS,		/* Key held past the long press delay */
+	KEYPAD_REPEAT,			/* Key still held after a long press */
+	KEYPAD_CHORD			/* Second key pressed while the first is held */
+};
+
+struct KeyEvent
+{
+	char key;				/* Symbol of the key */
+	struct key position;	/* Row and column, or 0 and the key code */
+	KeyEventType type;		/* Gesture */
+	char with;				/* Held key of a chord, 0 otherwise */
+	int duration;			/* Time the key has been held in milliseconds */
+	long long time;			/* CLOCK_MONOTONIC time of the edge in microseconds */
+};
+
+class Keypad
+{
+protected:
+	struct key held = {-1, -1};
+	struct key chorded = {-1, -1};
+	unsigned int pressedAt = 0;
+	unsigned int chordedAt = 0;
+	unsigned int nextGesture = 0;
+	bool longPressed = false;
+	bool chordSeen = false;
+	int longPressDelay = LONG_PRESS_DELAY;
+	int repeatInterval = REPEAT_INTERVAL;
+
+	virtual char getSymbol(struct key k) = 0;
+	void setEvent(struct KeyEvent *event, struct key k, KeyEventType type, long long time);
+	static bool isSameKey(struct key a, struct key b);
+	bool updateKeys(struct key *keys, int count, long long time, struct KeyEvent *event);
+	int getGestureTimeout(void);
+	bool checkGesture(struct KeyEvent *event);
+	static unsigned int getMillis(void);
+
+public:
+	virtual ~Keypad();
+	virtual bool getEvent(struct KeyEvent *event, const std::atomic<bool> *terminator) = 0;
+	virtual void printDetails(void) = 0;
+	void setLongPressDelay(int delay);
+	void setRepeatInterval(int interval);
+	int getLongPressDelay(void);
+	int getRepeatInterval(void);
+	static long long timestamp(void);
+};
+
+#endif
@@ -35,9 +35,15 @@
 #define _MIDI_IO_H_
 
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <climits>
 
 #include "RtMidi.h"
 
+#define		DEFAULT_INPUT_QUEUE_SIZE	256
+
 /**
  * MidiIO Class Interface
  *
@@ -66,6 +72,14 @@ private:
 	 */
 	bool debug;
 
+	/**
+	 * Scheduled Output Flag
+	 *
+	 * If set, playback is timed by the sequencer queue instead of the
+	 * application
+	 */
+	bool queueEnabled;
+
 	/**
 	 * RtMidi Input instance
 	 */
@@ -76,6 +90,32 @@ private:
 	 */
 	RtMidiOut *out;
 
+	/**
+	 * Input wakeup lock
+	 */
+	std::mutex inputMutex;
+
+	/**
+	 * Signalled when a message arrives or a waiter is interrupted
+	 */
+	std::condition_variable inputReady;
+
+	/**
+	 * Interrupt Flag
+	 *
+	 * Set by interrupt() and cleared by the waiter it wakes up
+	 */
+	bool interrupted;
+
+	/**
+	 * Input Notifier
+	 *
+	 * Called by the RtMidi input thread after every queued message
+	 *
+	 * @param userData 	MidiIO instance
+	 */
+	static void inputNotifier(void *userData);
+
 	/**
 	 * Initialize MIDI IO
 	 *
@@ -111,6 +151,45 @@ public:
 	 */
 	void enableDebug(bool enable);
 
+	/**
+	 * Enable Scheduled Output
+	 *
+	 * This option will let the sequencer queue time the playback
+	 * 
+	 * @param 	bool 	enable
+	 */
+	void enableQueue(bool enable);
+
+	/**
+	 * Check Scheduled Output
+	 * 
+	 * @return  true if scheduled output is enabled
+	 */
+	bool isQueueEnabled(void);
+
+	/**
+	 * Set Input Queue Size
+	 *
+	 * Only takes effect while the input port is closed
+	 * 
+	 * @param size 	maximum number of pending messages
+	 */
+	void setInputQueueSize(unsigned int size);
+
+	/**
+	 * Get Input Queue Overflow Count
+	 * 
+	 * @return  number of messages dropped because the input queue was full
+	 */
+	unsigned long getInputOverflowCount(void);
+
+	/**
+	 * Get SysEx Overflow Count
+	 * 
+	 * @return  number of SysEx messages dropped because the side queue was full
+	 */
+	unsigned long getSysexOverflowCount(void);
+
 	/**
 	 * Open MIDI Input Port
 	 * 
@@ -146,13 +225,108 @@ public:
 	 */
 	void sendMessage(std::vector<unsigned char> *message);
 
+	/**
+	 * Send Raw MIDI Message to Output Port
+	 * 
+	 * @param message 	message bytes
+	 * @param size 		message size
+	 */
+	void sendMessage(const unsigned char *message, size_t size);
+
+	/**
+	 * Send Several MIDI Messages to Output Port
+	 *
+	 * Messages are stored back to back and flushed to the device at once.
+	 * 
+	 * @param messages 	concatenated message bytes
+	 * @param sizes 	size of each message
+	 * @param count 	number of messages
+	 */
+	void sendMessages(const unsigned char *messages, const size_t *sizes, size_t count);
+
+	/**
+	 * Start Output Queue
+	 *
+	 * The queue time starts at zero and counts song microseconds,
+	 * stretched by the tempo scale
+	 * 
+	 * @param  tempoScale 	real time per song time
+	 * @return            	status
+	 */
+	int startQueue(double tempoScale);
+
+	/**
+	 * Set Output Queue Tempo
+	 *
+	 * Scheduled events keep their timestamps, only the queue speed changes
+	 * 
+	 * @param tempoScale 	real time per song time
+	 */
+	void setQueueTempo(double tempoScale);
+
+	/**
+	 * Schedule MIDI Messages
+	 *
+	 * Queue ticks are 32 bit microseconds, so times past about 71 minutes
+	 * are clamped to the last tick
+	 * 
+	 * @param messages 	concatenated message bytes
+	 * @param sizes 	size of each message
+	 * @param count 	number of messages
+	 * @param time 		song time in microseconds
+	 */
+	void scheduleMessages(const unsigned char *messages, const size_t *sizes, size_t count, long long time);
+
+	/**
+	 * Get Output Queue Time
+	 * 
+	 * @return  song time in microseconds
+	 */
+	long long getQueueTime(void);
+
+	/**
+	 * Wait for Output Queue
+	 *
+	 * Blocks until every scheduled message has been sent
+	 */
+	void syncQueue(void);
+
+	/**
+	 * Stop Output Queue
+	 *
+	 * Pending events are discarded and every channel is silenced
+	 */
+	void stopQueue(void);
+
 	/**
 	 * Receive MIDI message from Input port
+	 *
+	 * Returns immediately, leaving the container empty if there is no message
 	 * 
 	 * @param  message 	message container
 	 * @return         	stamp
 	 */
 	double getMessage(std::vector<unsigned char> *message);
+
+	/**
+	 * Wait for MIDI message from Input port
+	 *
+	 * Blocks until a message arrives, interrupt() is called, or the timeout
+	 * expires. The container is left empty if no message was received.
+	 * 
+	 * @param  message 	message container
+	 * @param  timeout 	timeout in milliseconds, negative to wait forever
+	 * @return         	stamp
+	 */
+	double waitMessage(std::vector<unsigned char> *message, int timeout = -1);
+
+	/**
+	 * Interrupt Input Wait
+	 *
+	 * Wakes up the thread blocked in waitMessage(). If no thread is waiting,
+	 * the next call to waitMessage() returns immediately.
+	 */
+	void interrupt(void);
 };
 
 #endif
\ No newline at end of file
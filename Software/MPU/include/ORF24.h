@@ -28,30 +28,161 @@
 #include <iostream>
 #include <string>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
 #include <wiringPi.h>
 #include <wiringPiSPI.h>
 #include "nRF24L01.h"
+#include "GpioLines.h"
+#include "BurstAccount.h"
 
 #define 	MOSI_PIN		12
 #define 	SLCK_PIN		14
 
+#define 	WRITE_TIMEOUT	500
+#define 	TX_FIFO_DEPTH	3
+#define 	SHADOW_SIZE		(FEATURE + 1)
+#define 	ADDRESS_SIZE	5
+#define 	SPI_MAX_TRANSFERS	16
+#define 	SPI_TRANSACTION_SIZE	256
+#define 	POWER_UP_DELAY	150
+#define 	RF_CHANNELS		126
+#define 	RPD_DELAY		170
+#define 	MAX_PAYLOAD_SIZE	32
+#define 	ACK_QUEUE_SIZE	4
+
 class ORF24
 {
+public:
+
+	/**
+	 * Asynchronous write completion callback
+	 *
+	 * @param success 	true if the payload was acknowledged
+	 * @param userData 	user data given to startWrite
+	 */
+	typedef void (*WriteCallback)(bool success, void *userData);
+
 private:
 	int ce;							/* CE pin number */
+	GpioLines ceLine;				/* CE on the GPIO character device, if requested */
 	int csn;						/* CSN pin number */
 	int spiChannel;					/* Odroid SPI channel */
 	int spiSpeed;					/* SPI clock frequency in Hz */		
 	int payloadSize;				/* nRF24L01 payload size */
-	int ackPayloadAvailable;		/* Whether there is an ack payload waiting */
-	bool ackPayloadLength;			/* Dynamic size of pending ack payload */
-	bool dynamicPayloadAvailable;	/* Whether dynamic payload are enabled */
+	int burstDepth = TX_FIFO_DEPTH;	/* Payloads in flight during a burst */
+	int ackPayloadAvailable = 0;	/* Number of ack payloads waiting */
+	int ackPayloadLength[ACK_QUEUE_SIZE];	/* Dynamic size of waiting ack payloads */
+	unsigned char ackPayload[ACK_QUEUE_SIZE][MAX_PAYLOAD_SIZE];	/* Waiting ack payloads */
+	int ackPayloadHead = 0;			/* Oldest waiting ack payload */
+	unsigned long ackPayloadDropped = 0;	/* Ack payloads overwritten before read */
+	bool ackPayloadEnabled = false;	/* Whether ack payloads are enabled */
+	bool dynamicPayloadAvailable = false;	/* Whether dynamic payload are enabled */
+	bool dynamicAckEnabled = false;	/* Whether payloads may skip the ACK */
 	bool debug = false;				/* Debug flag */
-	unsigned char buffer[32];		/* RX and TX buffer */
+	unsigned char buffer[33];		/* RX and TX buffer, command and payload */
 	unsigned char *pipe0ReadingAddress;
+	int irq = -1;					/* IRQ pin number, -1 when polling */
+	unsigned long irqCount = 0;		/* Number of IRQ edges seen */
+	std::mutex irqMutex;			/* IRQ state lock */
+	std::condition_variable irqSignal;	/* Signalled on every IRQ edge */
+	WriteCallback writeCallback = NULL;	/* Pending asynchronous write */
+	void *writeUserData = NULL;		/* Pending write callback argument */
+	unsigned long writeIrqCount = 0;	/* IRQ count when the asynchronous write started */
+	static ORF24 *irqInstance;		/* Instance served by the ISR */
+	PowerPolicy powerPolicy = POWER_DOWN_AFTER_WRITE;	/* When to leave Standby-I */
+	unsigned int idleTimeout = 0;	/* Standby-I idle time in ms before power down */
+	bool inSession = false;			/* Whether a session is running */
+	bool poweredUp = false;			/* Whether the chip is out of power down */
+	unsigned int lastActivity = 0;	/* millis() at the end of the last write */
+	unsigned char lastStatus = 0;	/* STATUS clocked out by the last transfer */
+	unsigned char shadow[SHADOW_SIZE];	/* Register shadow */
+	unsigned int shadowValid = 0;	/* Valid shadow registers, one bit each */
+	unsigned char addressShadow[3][ADDRESS_SIZE];	/* RX_ADDR_P0, RX_ADDR_P1, TX_ADDR shadow */
+	bool addressValid[3] = {false, false, false};	/* Valid address shadows */
+	unsigned long cacheHits = 0;	/* SPI transfers saved by the shadow */
+	unsigned long cacheMisses = 0;	/* SPI transfers of cacheable registers */
+	int spiFd = -1;					/* spidev file descriptor */
+	bool inTransaction = false;		/* Whether transfers are being queued */
+	struct spi_ioc_transfer transfers[SPI_MAX_TRANSFERS];	/* Queued transfers */
+	unsigned char txData[SPI_TRANSACTION_SIZE];	/* Queued transfer bytes */
+	unsigned char rxData[SPI_TRANSACTION_SIZE];	/* Bytes clocked in by queued transfers */
+	int transferCount = 0;			/* Number of queued transfers */
+	int transactionSize = 0;		/* Number of queued bytes */
+	unsigned int poweredUpAt = 0;	/* micros() when PWR_UP was last set */
+	unsigned long spiTransfers = 0;	/* SPI commands sent */
+	unsigned long spiCalls = 0;		/* SPI system calls made */
+	unsigned char observeTX = 0;	/* OBSERVE_TX at the end of the last write */
+	unsigned int writeStartedAt = 0;	/* micros() when CE was raised */
+	unsigned int writeTime = 0;		/* Duration of the last write in us */
 
 protected:
 
+	/**
+	 * Drive the CE pin
+	 *
+	 * Goes through the GPIO character device when enableGpioChip()
+	 * succeeded, through wiringPi otherwise.
+	 * 
+	 * @param level 	HIGH or LOW
+	 */
+	void setCE(int level);
+
+	/**
+	 * Check whether a register can live in the shadow
+	 *
+	 * Status and measurement registers are changed by the chip itself.
+	 * 
+	 * @param  reg 	register address
+	 * @return     	true if cacheable
+	 */
+	static bool isCacheable(unsigned char reg);
+
+	/**
+	 * Get address shadow slot of a register
+	 * 
+	 * @param  reg 	register address
+	 * @return     	slot number, -1 if the register has no address shadow
+	 */
+	static int getAddressSlot(unsigned char reg);
+
+	/**
+	 * Run one SPI command
+	 *
+	 * Inside a transaction, commands whose reply is not needed are queued.
+	 * Commands that need the reply submit the queue first to keep the order.
+	 * 
+	 * @param  data 	command bytes, replaced by the reply when run at once
+	 * @param  len  	command length in byte
+	 * @param  reply 	whether the caller reads the reply
+	 * @return      	nRF24L01 status, the last known one when queued
+	 */
+	unsigned char transfer(unsigned char *data, int len, bool reply);
+
+	/**
+	 * Submit queued SPI commands in one system call
+	 * 
+	 * @return  status clocked out by the first queued command
+	 */
+	unsigned char submitTransaction(void);
+
+	/**
+	 * Wait until the oscillator has started after power up
+	 */
+	void waitStandby(void);
+
+	/**
+	 * Clear status, power down if allowed and flush TX FIFO
+	 * 
+	 * @return  status before clearing
+	 */
+	unsigned char endWrite(void);
+
 	/**
 	 * Read one byte from nRF24L01 register
 	 * 
@@ -98,6 +229,16 @@ protected:
 	 */
 	unsigned char writePayload(unsigned char *data, int len);
 
+	/**
+	 * Write payload to send with a given command
+	 * 
+	 * @param  data 	data to send
+	 * @param  len  	data length in byte
+	 * @param  command 	W_TX_PAYLOAD or W_TX_PAYLOAD_NO_ACK
+	 * @return      	nRF24L01 status
+	 */
+	unsigned char writePayload(unsigned char *data, int len, unsigned char command);
+
 	/**
 	 * Read received payload
 	 * 
@@ -107,6 +248,20 @@ protected:
 	 */
 	unsigned char readPayload(unsigned char *data, int len);
 
+	/**
+	 * Get width of the payload on top of the RX FIFO
+	 * 
+	 * @return  payload width in byte
+	 */
+	int getDynamicPayloadSize(void);
+
+	/**
+	 * Move ack payloads from the RX FIFO to the ack queue
+	 *
+	 * The oldest waiting payload is overwritten when the queue is full.
+	 */
+	void receiveAckPayloads(void);
+
 	/**
 	 * Flush RX FIFO
 	 * 
@@ -158,6 +313,61 @@ protected:
 	 */
 	void printAllRegister(void);
 
+	/**
+	 * Finish a transmission
+	 *
+	 * Clears the status flags, powers down and flushes the TX FIFO
+	 * 
+	 * @return  true if the payload was acknowledged
+	 */
+	bool finishWrite(void);
+
+	/**
+	 * Start writing payload with a given command
+	 * 
+	 * @param data 		data to write
+	 * @param len  		data length
+	 * @param command 	W_TX_PAYLOAD or W_TX_PAYLOAD_NO_ACK
+	 */
+	void startWrite(unsigned char *data, int len, unsigned char command);
+
+	/**
+	 * Leave power down and select TX mode
+	 *
+	 * Oscillator start-up is only paid when the chip is powered down
+	 */
+	void prepareWrite(void);
+
+	/**
+	 * Wait for the next transmission event
+	 *
+	 * Sleeps on the IRQ in IRQ mode, otherwise returns at once so the
+	 * caller polls STATUS.
+	 *
+	 * @param seen 	IRQ count already handled, updated on return
+	 */
+	void waitTransmission(unsigned long *seen);
+
+	/**
+	 * Get the number of IRQ edges seen
+	 *
+	 * @return  IRQ count
+	 */
+	unsigned long getIrqCount(void);
+
+	/**
+	 * Handle IRQ edge
+	 *
+	 * Only counts the edge and wakes up waiting writers, SPI stays with
+	 * the thread that issued the write
+	 */
+	void onInterrupt(void);
+
+	/**
+	 * IRQ service routine registered with wiringPi
+	 */
+	static void irqHandler(void);
+
 
 public:
 
@@ -178,6 +388,45 @@ public:
 	 */
 	bool begin(void);
 
+	/**
+	 * Enable IRQ driven transmission
+	 *
+	 * The IRQ line is watched by a wiringPi ISR, so writes sleep instead of
+	 * polling the status register. Only one ORF24 instance can use the IRQ.
+	 * 
+	 * @param  pin 	wiringPi pin wired to the nRF24L01 IRQ
+	 * @return     	status
+	 */
+	bool enableIRQ(int pin);
+
+	/**
+	 * Set burst depth
+	 *
+	 * A depth of 1 keeps one payload in flight, so every result of
+	 * writeBurst() is exact and no payload is ever sent twice.
+	 * 
+	 * @param depth 	payloads in flight during writeBurst(), 1 to TX_FIFO_DEPTH
+	 */
+	void setBurstDepth(int depth);
+
+	/**
+	 * Drive CE through the GPIO character device
+	 *
+	 * CE is toggled for every payload, the line request turns each toggle
+	 * into one ioctl without going through wiringPi. Call after begin().
+	 * 
+	 * @param  chip 	GPIO chip device
+	 * @return      	status
+	 */
+	bool enableGpioChip(const char *chip);
+
+	/**
+	 * Check IRQ driven transmission
+	 * 
+	 * @return  true if IRQ mode is enabled
+	 */
+	bool isIRQEnabled(void);
+
 	/**
 	 * Write payload to open writing pipe
 	 * 
@@ -187,6 +436,20 @@ public:
 	 */
 	bool write(unsigned char *data, int len);
 
+	/**
+	 * Write payload to open writing pipe, optionally without ACK
+	 *
+	 * A multicast payload is sent once and no receiver acknowledges it,
+	 * so any number of receivers can listen on the address. Needs
+	 * enableDynamicAck().
+	 * 
+	 * @param  data 		data to write
+	 * @param  len  		data length
+	 * @param  multicast 	skip the acknowledgement
+	 * @return      		true if the payload was acknowledged, or sent for multicast
+	 */
+	bool write(unsigned char *data, int len, bool multicast);
+
 	/**
 	 * Start writing payload
 	 * 
@@ -195,6 +458,87 @@ public:
 	 */
 	void startWrite(unsigned char *data, int len);
 
+	/**
+	 * Start writing payload asynchronously
+	 *
+	 * The callback runs from completeWrite() on the calling thread once the
+	 * transmission ends. Only one write may be in flight. Without IRQ mode,
+	 * the write blocks and the callback runs before this method returns.
+	 * 
+	 * @param data 		data to write
+	 * @param len  		data length
+	 * @param callback 	completion callback
+	 * @param userData 	callback argument
+	 */
+	void startWrite(unsigned char *data, int len, WriteCallback callback, void *userData);
+
+	/**
+	 * Complete an asynchronous write
+	 *
+	 * Waits for the IRQ of the pending write, then finishes it and runs its
+	 * callback. A write without IRQ after WRITE_TIMEOUT completes as failed.
+	 * 
+	 * @param  timeout 	maximum waiting time in miliseconds
+	 * @return         	true if no write is pending anymore
+	 */
+	bool completeWrite(int timeout);
+
+	/**
+	 * Write several payloads in one air burst
+	 *
+	 * The TX FIFO is kept full and CE is held high across payloads. A
+	 * payload that reaches the retry limit is dropped and the rest of the
+	 * burst goes on. When merged completions hide which payload failed,
+	 * every payload without a result is sent again, so receivers must
+	 * tolerate duplicates unless the burst depth is 1.
+	 * 
+	 * @param  payloads 	payloads to write
+	 * @param  lengths  	payload lengths
+	 * @param  count    	number of payloads
+	 * @param  results  	per payload acknowledgement, may be null
+	 * @return          	number of acknowledged payloads
+	 */
+	int writeBurst(unsigned char *const *payloads, const int *lengths, int count, bool *results);
+
+	/**
+	 * Enable dynamic payload length on every pipe
+	 *
+	 * Payloads are no longer padded to the payload size. Needs an
+	 * nRF24L01+ on both ends.
+	 */
+	void enableDynamicPayloads(void);
+
+	/**
+	 * Enable payloads in acknowledgement packets
+	 *
+	 * Receivers can then return data with the ACK of each payload. Turns
+	 * on dynamic payload length too.
+	 */
+	void enableAckPayload(void);
+
+	/**
+	 * Allow payloads that ask for no acknowledgement
+	 */
+	void enableDynamicAck(void);
+
+	/**
+	 * Check for a received ack payload
+	 * 
+	 * @return  true if an ack payload is waiting
+	 */
+	bool isAckPayloadAvailable(void);
+
+	/**
+	 * Read the oldest received ack payload
+	 *
+	 * Ack payloads are kept from the start of the last write.
+	 * 
+	 * @param  data 	buffer to read into
+	 * @param  len  	buffer size
+	 * @return      	payload width, 0 if none was waiting
+	 */
+	int readAckPayload(unsigned char *data, int len);
+
 	/**
 	 * Set delay and number of retry for retransmission
 	 *
@@ -210,6 +554,37 @@ public:
 	 */
 	void setChannel(int channel);
 
+	/**
+	 * Get RF channel
+	 * 
+	 * @return  channel number
+	 */
+	int getChannel(void);
+
+	/**
+	 * Survey received power on every RF channel
+	 *
+	 * Listens on each channel in turn and counts the samples where RPD
+	 * reports a carrier above -64 dBm. The chip is left powered down on
+	 * its previous channel.
+	 * 
+	 * @param histogram 	RF_CHANNELS counters of busy samples
+	 * @param sweeps    	number of passes over all channels
+	 */
+	void scanChannels(int *histogram, int sweeps);
+
+	/**
+	 * Pick the quietest channel of a survey
+	 *
+	 * Neighbour channels count too, a 2 Mbps link is 2 MHz wide. Ties go
+	 * to the channel closest to the preferred one.
+	 * 
+	 * @param  histogram 	RF_CHANNELS counters of busy samples
+	 * @param  preferred 	channel to keep when it is as quiet as any
+	 * @return           	channel number
+	 */
+	static int getQuietestChannel(const int *histogram, int preferred);
+
 	/**
 	 * Set payload size
 	 * 
@@ -258,6 +633,50 @@ public:
 	 */
 	void powerUp(void);
 
+	/**
+	 * Set power policy
+	 *
+	 * With STANDBY_IN_SESSION the chip stays in Standby-I between writes
+	 * of a session, and only powers down after the idle timeout or at the
+	 * end of the session.
+	 * 
+	 * @param policy 	power policy
+	 * @param timeout 	idle timeout in milliseconds
+	 */
+	void setPowerPolicy(PowerPolicy policy, unsigned int timeout);
+
+	/**
+	 * Begin power session
+	 *
+	 * Starts the oscillator early, the first write only waits for what is
+	 * left of the start-up time
+	 */
+	void beginSession(void);
+
+	/**
+	 * End power session
+	 */
+	void endSession(void);
+
+	/**
+	 * Check power session
+	 * 
+	 * @return  true if a session is running
+	 */
+	bool isInSession(void);
+
+	/**
+	 * Get Standby-I time left
+	 * 
+	 * @return  milliseconds until idle power down, -1 if powered down
+	 */
+	int getStandbyTimeLeft(void);
+
+	/**
+	 * Power down if the idle timeout has passed
+	 */
+	void powerDownIfIdle(void);
+
 	/**
 	 * Set nRF24L01 to power down mode
 	 */
@@ -283,6 +702,78 @@ public:
 	 */
 	void enableDebug(void);
 
+	/**
+	 * Forget the register shadow
+	 *
+	 * Call it when the chip may have been reset behind our back
+	 */
+	void invalidateCache(void);
+
+	/**
+	 * Get register shadow hit count
+	 * 
+	 * @return  SPI transfers saved by the shadow
+	 */
+	unsigned long getCacheHits(void);
+
+	/**
+	 * Get register shadow miss count
+	 * 
+	 * @return  SPI transfers of cacheable registers
+	 */
+	unsigned long getCacheMisses(void);
+
+	/**
+	 * Get retransmission count of the last written payload
+	 * 
+	 * @return  ARC_CNT
+	 */
+	int getRetryCount(void);
+
+	/**
+	 * Get lost packet count
+	 *
+	 * Counts payloads that reached the retry limit, saturates at 15
+	 * 
+	 * @return  PLOS_CNT
+	 */
+	int getLostCount(void);
+
+	/**
+	 * Reset lost packet count
+	 */
+	void resetLostCount(void);
+
+	/**
+	 * Get duration of the last write
+	 *
+	 * Measured from the first CE pulse until the transmission ended
+	 * 
+	 * @return  time in microseconds
+	 */
+	unsigned int getWriteTime(void);
+
+	/**
+	 * Start an SPI transaction
+	 *
+	 * Register writes, payload writes and FIFO flushes are queued until
+	 * commitTransaction() and then sent in one system call. Starting a
+	 * transaction while one is open continues it.
+	 */
+	void beginTransaction(void);
+
+	/**
+	 * Send queued SPI commands and end the transaction
+	 * 
+	 * @return  status clocked out by the first command of the last submit
+	 */
+	unsigned char commitTransaction(void);
+
+	/**
+	 * Print register shadow and SPI statistics in debug mode
+	 */
+	void printSPIStatistics(void);
+
 
 };
 
@@ -0,0 +1,212 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _PITCH_SET_H_
+#define _PITCH_SET_H_
+
+#include <stdint.h>
+
+#define		PITCH_COUNT		128
+#define		NO_PITCH		-1
+
+/**
+ * PitchSet Class Interface
+ *
+ * A set of MIDI note numbers held as a 128-bit mask. Membership, insertion
+ * and nearest neighbour lookups are a handful of bit operations.
+ */
+class PitchSet
+{
+private:
+
+	/**
+	 * Note 0-63 in word 0, note 64-127 in word 1
+	 */
+	uint64_t bits[2];
+
+	/**
+	 * Lowest set bit of a word, or -1 if the word is empty
+	 */
+	static int lowest(uint64_t word)
+	{
+		return word ? __builtin_ctzll(word) : NO_PITCH;
+	}
+
+	/**
+	 * Highest set bit of a word, or -1 if the word is empty
+	 */
+	static int highest(uint64_t word)
+	{
+		return word ? 63 - __builtin_clzll(word) : NO_PITCH;
+	}
+
+public:
+
+	/**
+	 * PitchSet Class Constructor
+	 */
+	PitchSet() { clear(); }
+
+	/**
+	 * Remove all notes
+	 */
+	void clear(void)
+	{
+		bits[0] = bits[1] = 0;
+	}
+
+	/**
+	 * Add note to the set
+	 *
+	 * @param note 	MIDI note number
+	 */
+	void insert(unsigned char note)
+	{
+		bits[(note >> 6) & 1] |= 1ULL << (note & 63);
+	}
+
+	/**
+	 * Remove note from the set
+	 *
+	 * @param note 	MIDI note number
+	 */
+	void erase(unsigned char note)
+	{
+		bits[(note >> 6) & 1] &= ~(1ULL << (note & 63));
+	}
+
+	/**
+	 * Check note membership
+	 *
+	 * @param  note 	MIDI note number
+	 * @return      	true if the note is in the set
+	 */
+	bool contains(unsigned char note) const
+	{
+		return (bits[(note >> 6) & 1] >> (note & 63)) & 1;
+	}
+
+	/**
+	 * Check whether the set is empty
+	 *
+	 * @return  true if empty
+	 */
+	bool empty(void) const
+	{
+		return !(bits[0] | bits[1]);
+	}
+
+	/**
+	 * Get number of notes in the set
+	 *
+	 * @return  note count
+	 */
+	int count(void) const
+	{
+		return __builtin_popcountll(bits[0]) + __builtin_popcountll(bits[1]);
+	}
+
+	/**
+	 * Find the lowest note at or above a pitch
+	 *
+	 * @param  note 	MIDI note number
+	 * @return      	note number, or NO_PITCH
+	 */
+	int above(int note) const
+	{
+		if (note < 0)
+			note = 0;
+
+		if (note < 64)
+		{
+			int low = lowest(bits[0] & (~0ULL << note));
+			if (low != NO_PITCH)
+				return low;
+			note = 64;
+		}
+
+		if (note >= PITCH_COUNT)
+			return NO_PITCH;
+
+		int high = lowest(bits[1] & (~0ULL << (note - 64)));
+		return (high == NO_PITCH) ? NO_PITCH : high + 64;
+	}
+
+	/**
+	 * Find the highest note at or below a pitch
+	 *
+	 * @param  note 	MIDI note number
+	 * @return      	note number, or NO_PITCH
+	 */
+	int below(int note) const
+	{
+		if (note >= PITCH_COUNT)
+			note = PITCH_COUNT - 1;
+
+		if (note >= 64)
+		{
+			int high = highest(bits[1] & (~0ULL >> (127 - note)));
+			if (high != NO_PITCH)
+				return high + 64;
+			note = 63;
+		}
+
+		if (note < 0)
+			return NO_PITCH;
+
+		return highest(bits[0] & (~0ULL >> (63 - note)));
+	}
+
+	/**
+	 * Find the note closest to a pitch
+	 *
+	 * Ties go to the lower note.
+	 *
+	 * @param  note 	MIDI note number
+	 * @return      	note number, or NO_PITCH if the set is empty
+	 */
+	int nearest(int note) const
+	{
+		int low = below(note);
+		int high = above(note);
+
+		if (low == NO_PITCH)
+			return high;
+		if (high == NO_PITCH)
+			return low;
+
+		return (note - low <= high - note) ? low : high;
+	}
+};
+
+#endif
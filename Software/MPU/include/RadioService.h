@@ -0,0 +1,645 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _RADIO_SERVICE_H_
+#define _RADIO_SERVICE_H_
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <semaphore.h>
+
+#include "ORF24.h"
+#include "SpscQueue.h"
+
+#define		RIGHT_HAND_ADDRESS		"ArS01"
+#define		LEFT_HAND_ADDRESS		"ArS02"
+#define		BROADCAST_ADDRESS		"ArS00"
+#define		BROADCAST				2
+
+#define		FEEDBACK_QUEUE_SIZE		64
+#define		MAX_FEEDBACK_PAYLOAD	8
+#define		FEEDBACK_BATCH_SIZE		16
+
+#define		DRAIN_RESET				0x01
+#define		DRAIN_PRINT_RADIO		0x02
+
+#define		MOTOR_COUNT				10
+#define		MOTOR_OFF				0x80
+#define		MOTOR_ON				0x90
+#define		ALL_MOTOR_OFF			0xC0
+#define		ALL_MOTORS				0x3FF
+#define		SESSION_CUE_DURATION	10
+
+/* Packed feedback frame, version 1:
+ *   [0] PACKED_FEEDBACK
+ *   [1] motor mask, bit 0-7
+ *   [2] motor mask, bit 8-9 in bit 0-1, PACKED_SET in bit 7
+ *   [3] duration in 10 ms units, 0 for the module default
+ *   [4] intensity, 0 for full power
+ *   [5] sequence number, stamped by the worker
+ * The sequence number needs dynamic payloads, a resent frame keeps its
+ * number so the module can drop the copy.
+ */
+#define		PACKED_FEEDBACK			0xE1
+#define		PACKED_FEEDBACK_SIZE	5
+#define		SEQUENCED_FEEDBACK_SIZE	6
+#define		PACKED_SET				0x80
+#define		LEGACY_FEEDBACK_SIZE	1
+
+/* Link configuration frame, packed protocol only:
+ *   [0] LINK_CONFIG
+ *   [1] data rate, 0 for 1 Mbps, 1 for 2 Mbps
+ * The module switches after acknowledging it, and returns to 1 Mbps on
+ * its own after LINK_FALLBACK_TIMEOUT without traffic.
+ */
+#define		LINK_CONFIG				0xF1
+#define		LINK_FALLBACK_TIMEOUT	1000
+#define		LINK_CLEAN_WRITES		64
+#define		LINK_MAX_CLEAN_WRITES	4096
+#define		LINK_RETRY_BUDGET		5000
+#define		LINK_AVERAGE_WEIGHT		16
+
+/* Channel hop frame, packed protocol only:
+ *   [0] CHANNEL_HOP
+ *   [1] RF channel
+ * The module switches after acknowledging it, and returns to
+ * HOME_CHANNEL on its own after CHANNEL_FALLBACK_TIMEOUT without traffic.
+ */
+#define		CHANNEL_HOP				0xF2
+#define		HOME_CHANNEL			76
+#define		CHANNEL_FALLBACK_TIMEOUT	10000
+#define		CHANNEL_SURVEY_SWEEPS	20
+
+/* Telemetry frame, sent by the module in the ACK of each payload:
+ *   [0] TELEMETRY
+ *   [1] sequence number of the last feedback frame received
+ *   [2] feedback frames missed, rolling count
+ *   [3] supply voltage in 20 mV units
+ *   [4] motor state, bit 0-7
+ *   [5] motor state, bit 8-9 in bit 0-1
+ * The ACK carries the state from before the acknowledged payload.
+ */
+#define		TELEMETRY				0xE2
+#define		TELEMETRY_SIZE			6
+
+/**
+ * A feedback command waiting to be sent to a hand module
+ */
+struct FeedbackCommand
+{
+	int hand;									/* 0 for right hand, 1 for left hand, BROADCAST for both */
+	int length;									/* Payload length */
+	unsigned char payload[MAX_FEEDBACK_PAYLOAD];	/* Payload to send */
+	long long queuedAt;							/* Enqueue time in microseconds */
+};
+
+/**
+ * Link quality of one hand module
+ */
+struct LinkStats
+{
+	unsigned long acked;		/* Acknowledged payloads */
+	unsigned long failed;		/* Payloads that reached the retry limit */
+	unsigned long retries;		/* Retransmissions of the last payload of each write */
+	unsigned long lost;			/* Lost packets from PLOS_CNT */
+	double successRate;			/* Moving average of acknowledged payloads */
+	double meanRetries;			/* Moving average of retransmissions per write */
+	double roundTrip;			/* Moving average of air time per payload in us */
+	DataRate rate;				/* Data rate the module listens on */
+	int channel;				/* RF channel the module listens on */
+	int retryDelay;				/* ARD, (delay + 1) * 250 us */
+	int retryCount;				/* ARC */
+	int cleanWrites;			/* Payloads sent without retransmission in a row */
+	int upgradeAfter;			/* Clean payloads needed before trying 2 Mbps */
+	long long lostUpgrade;		/* Time of an unacknowledged 2 Mbps request in us, 0 if none */
+	long long lastAck;			/* Time of the last acknowledgement in us */
+	unsigned long telemetry;	/* Telemetry frames received */
+	unsigned long missed;		/* Feedback frames the module never received */
+	int reportedMissed;			/* Rolling missed count of the last telemetry, -1 if none */
+	unsigned char sequence;		/* Sequence number of the last feedback frame */
+	double battery;				/* Module supply voltage in V, 0 if unknown */
+	unsigned short motors;		/* Motors the module reports as running */
+	long long lastTelemetry;	/* Time of the last telemetry in us */
+};
+
+/**
+ * RadioService Class Interface
+ *
+ * RadioService owns the radio transceiver and runs it on its own thread.
+ * The player and the evaluator only enqueue feedback commands, so a lost
+ * ACK or a slow SPI transaction never stalls MIDI output.
+ */
+class RadioService
+{
+private:
+
+	/**
+	 * Radio transceiver handler
+	 */
+	ORF24 *rf;
+
+	/**
+	 * Feedback command queue
+	 */
+	SpscQueue<FeedbackCommand, FEEDBACK_QUEUE_SIZE> queue;
+
+	/**
+	 * Counts queued commands, the worker sleeps on it
+	 */
+	sem_t pending;
+
+	/**
+	 * Worker thread
+	 */
+	std::thread worker;
+
+	/**
+	 * Worker running flag
+	 */
+	std::atomic<bool> running;
+
+	/**
+	 * Requested power session state, applied by the worker
+	 */
+	std::atomic<bool> session;
+
+	/**
+	 * Send one byte commands for hand modules without packed support
+	 */
+	bool legacy;
+
+	/**
+	 * RF channel the hand modules are moved to
+	 */
+	int channel;
+
+	/**
+	 * Link quality and policy of each hand, only touched by the worker
+	 */
+	LinkStats link[2];
+
+	/**
+	 * Copy of link[] taken by the worker on the last drain
+	 */
+	LinkStats linkSnapshot[2];
+
+	/**
+	 * Drain jobs waiting for the worker, DRAIN_* flags
+	 */
+	int drainJobs;
+
+	/**
+	 * Number of drains requested
+	 */
+	unsigned long drainRequest;
+
+	/**
+	 * Last drain request completed by the worker
+	 */
+	unsigned long drainDone;
+
+	/**
+	 * Drain state lock
+	 */
+	std::mutex drainMutex;
+
+	/**
+	 * Signalled when the worker completes a drain
+	 */
+	std::condition_variable drainSignal;
+
+	/**
+	 * Number of commands sent and acknowledged
+	 */
+	std::atomic<unsigned long> sent;
+
+	/**
+	 * Number of commands that were not acknowledged
+	 */
+	std::atomic<unsigned long> failed;
+
+	/**
+	 * Number of commands dropped because the queue was full
+	 */
+	std::atomic<unsigned long> dropped;
+
+	/**
+	 * Deepest queue seen by the worker
+	 */
+	std::atomic<unsigned int> maxDepth;
+
+	/**
+	 * Largest enqueue to completion latency in microseconds
+	 */
+	std::atomic<long long> maxLatency;
+
+	/**
+	 * Sum of enqueue to completion latency in microseconds
+	 */
+	std::atomic<long long> totalLatency;
+
+	/**
+	 * Worker thread routine
+	 */
+	void run(void);
+
+	/**
+	 * Wait for a queued command or a session change
+	 *
+	 * While the radio is held in Standby-I, the wait ends at the idle
+	 * timeout.
+	 *
+	 * @return  false if the idle timeout passed
+	 */
+	bool waitPending(void);
+
+	/**
+	 * Wait until the worker has emptied the queue and run the given jobs
+	 *
+	 * Runs the jobs on the calling thread if the worker is stopped.
+	 *
+	 * @param jobs 	DRAIN_* flags
+	 */
+	void runWhenDrained(int jobs);
+
+	/**
+	 * Run drain jobs and copy the link statistics
+	 *
+	 * Called by the worker with an empty queue.
+	 *
+	 * @param jobs 	DRAIN_* flags
+	 */
+	void runDrainJobs(int jobs);
+
+	/**
+	 * Send a batch of commands with the radio
+	 *
+	 * Broadcast commands split the batch, so they keep their order
+	 * against the commands around them.
+	 *
+	 * @param commands 	feedback commands
+	 * @param count 	number of commands
+	 */
+	void transmit(FeedbackCommand *commands, int count);
+
+	/**
+	 * Send commands that are addressed to one hand
+	 *
+	 * Commands are grouped by hand, each group goes out in one burst.
+	 *
+	 * @param commands 	feedback commands
+	 * @param count 	number of commands
+	 */
+	void transmitHands(FeedbackCommand *commands, int count);
+
+	/**
+	 * Send a command to both hands without acknowledgement
+	 *
+	 * Hands that listen on different link settings get one copy each.
+	 *
+	 * @param command 	feedback command
+	 */
+	void transmitBroadcast(FeedbackCommand *command);
+
+	/**
+	 * Send payloads to one hand with its link settings
+	 *
+	 * Payloads that fail at 2 Mbps are sent again at 1 Mbps, and payloads
+	 * that fail away from HOME_CHANNEL are sent again there, in case the
+	 * module has already fallen back.
+	 *
+	 * @param hand 		0 for right hand, 1 for left hand
+	 * @param payloads 	payloads to send
+	 * @param lengths 	payload lengths
+	 * @param n 		number of payloads
+	 * @param results 	per payload acknowledgement
+	 */
+	void transmitHand(int hand, unsigned char **payloads, int *lengths, int n, bool *results);
+
+	/**
+	 * Send the failed payloads of a write again
+	 *
+	 * @param  hand 		0 for right hand, 1 for left hand
+	 * @param  payloads 	payloads of the write
+	 * @param  lengths 		payload lengths
+	 * @param  n 			number of payloads
+	 * @param  results 		per payload acknowledgement, updated
+	 * @return          	number of payloads acknowledged now
+	 */
+	int retryFailed(int hand, unsigned char **payloads, int *lengths, int n, bool *results);
+
+	/**
+	 * Apply the link settings of a hand to the radio
+	 *
+	 * @param hand 	0 for right hand, 1 for left hand
+	 */
+	void applyLink(int hand);
+
+	/**
+	 * Tune the radio to the channel and data rate of a hand
+	 *
+	 * Leaves the writing pipe to the caller
+	 *
+	 * @param hand 	0 for right hand, 1 for left hand
+	 */
+	void tuneLink(int hand);
+
+	/**
+	 * Update link quality after a write and adapt retransmission
+	 *
+	 * @param hand 		0 for right hand, 1 for left hand
+	 * @param results 	per payload acknowledgement
+	 * @param n 		number of payloads
+	 */
+	void updateLink(int hand, const bool *results, int n);
+
+	/**
+	 * Read the telemetry returned with the last write
+	 *
+	 * @param hand 	0 for right hand, 1 for left hand
+	 */
+	void receiveTelemetry(int hand);
+
+	/**
+	 * Ask a hand module to change data rate
+	 *
+	 * @param  hand 	0 for right hand, 1 for left hand
+	 * @param  rate 	new data rate
+	 * @return      	true if the module acknowledged
+	 */
+	bool configureLink(int hand, DataRate rate);
+
+	/**
+	 * Ask a hand module to change RF channel
+	 *
+	 * @param  hand 	0 for right hand, 1 for left hand
+	 * @param  target 	new channel
+	 * @return      	true if the module acknowledged
+	 */
+	bool hopChannel(int hand, int target);
+
+	/**
+	 * Look for a hand module on a channel it was asked to hop to
+	 *
+	 * @param  hand 	0 for right hand, 1 for left hand
+	 * @param  target 	hop channel
+	 * @return      	true if the module answered on the target channel
+	 */
+	bool probeChannel(int hand, int target);
+
+	/**
+	 * Update statistics of a sent command
+	 *
+	 * @param command 	feedback command
+	 * @param success 	true if the command was acknowledged
+	 */
+	void account(FeedbackCommand *command, bool success);
+
+	/**
+	 * Get monotonic timestamp
+	 *
+	 * @return  time in microseconds
+	 */
+	static long long timestamp(void);
+
+public:
+
+	/**
+	 * RadioService Class Constructor
+	 *
+	 * @param _rf 	initialized radio transceiver
+	 */
+	RadioService(ORF24 *_rf);
+
+	/**
+	 * RadioService Class Destructor
+	 */
+	~RadioService();
+
+	/**
+	 * Start worker thread
+	 */
+	void start(void);
+
+	/**
+	 * Stop worker thread
+	 *
+	 * Commands already in the queue are sent before the worker exits.
+	 */
+	void stop(void);
+
+	/**
+	 * Enqueue feedback command
+	 *
+	 * This method never blocks. Must only be called from one thread.
+	 *
+	 * @param  hand    	0 for right hand, 1 for left hand
+	 * @param  payload 	payload to send
+	 * @param  len     	payload length
+	 * @return         	false if the command was dropped
+	 */
+	bool send(int hand, const unsigned char *payload, int len);
+
+	/**
+	 * Enqueue vibrator command
+	 *
+	 * In packed mode the whole mask goes out in one payload, in legacy
+	 * mode every motor gets its own one byte command.
+	 *
+	 * @param  hand      	0 for right hand, 1 for left hand
+	 * @param  motors    	vibrator mask, bit n for motor n
+	 * @param  on        	turn the vibrators on or off
+	 * @param  duration  	on time in 10 ms units, 0 for the module default
+	 * @param  intensity 	vibration strength, 0 for full power
+	 * @return           	false if a command was dropped
+	 */
+	bool sendMotors(int hand, unsigned short motors, bool on, unsigned char duration = 0, unsigned char intensity = 0);
+
+	/**
+	 * Enqueue vibrator command for both hands
+	 *
+	 * In packed mode the command goes out once to the broadcast address,
+	 * without waiting for an acknowledgement. In legacy mode each hand gets
+	 * its own commands.
+	 *
+	 * @param  motors    	vibrator mask, bit n for motor n
+	 * @param  on        	turn the vibrators on or off
+	 * @param  duration  	on time in 10 ms units, 0 for the module default
+	 * @param  intensity 	vibration strength, 0 for full power
+	 * @return           	false if a command was dropped
+	 */
+	bool broadcastMotors(unsigned short motors, bool on, unsigned char duration = 0, unsigned char intensity = 0);
+
+	/**
+	 * Use one byte commands
+	 *
+	 * Old firmware has no sequence numbers to drop duplicates, so bursts
+	 * keep one payload in flight and are never resent blindly. Must be set
+	 * before the worker starts.
+	 *
+	 * @param enable 	true for hand modules without packed support
+	 */
+	void setLegacyProtocol(bool enable);
+
+	/**
+	 * Set RF channel of the hand modules
+	 *
+	 * The modules start on HOME_CHANNEL and are moved to this channel
+	 * before their next command. Needs the packed protocol. Must be set
+	 * before the worker starts.
+	 *
+	 * @param target 	channel number
+	 */
+	void setChannel(int target);
+
+	/**
+	 * Get payload size of the feedback protocol
+	 *
+	 * @return  payload size in bytes
+	 */
+	int getPayloadSize(void);
+
+	/**
+	 * Begin radio power session
+	 *
+	 * Lets the radio stay in Standby-I between commands until endSession(),
+	 * and gives both hands a short start cue in packed mode.
+	 */
+	void beginSession(void);
+
+	/**
+	 * End radio power session
+	 *
+	 * Turns off every motor of both hands.
+	 */
+	void endSession(void);
+
+	/**
+	 * Get radio transceiver handler
+	 *
+	 * Only use it while the worker is stopped.
+	 *
+	 * @return  radio handler
+	 */
+	ORF24 *getRadio(void);
+
+	/**
+	 * Get current queue depth
+	 *
+	 * @return  number of queued commands
+	 */
+	unsigned int getQueueDepth(void);
+
+	/**
+	 * Get maximum queue depth
+	 *
+	 * @return  deepest queue seen
+	 */
+	unsigned int getMaxQueueDepth(void);
+
+	/**
+	 * Get sent command count
+	 *
+	 * @return  number of acknowledged commands
+	 */
+	unsigned long getSentCount(void);
+
+	/**
+	 * Get failed command count
+	 *
+	 * @return  number of commands that were not acknowledged
+	 */
+	unsigned long getFailedCount(void);
+
+	/**
+	 * Get dropped command count
+	 *
+	 * @return  number of commands dropped on a full queue
+	 */
+	unsigned long getDroppedCount(void);
+
+	/**
+	 * Get maximum command latency
+	 *
+	 * @return  latency in microseconds
+	 */
+	long long getMaxLatency(void);
+
+	/**
+	 * Get mean command latency
+	 *
+	 * @return  latency in microseconds
+	 */
+	double getMeanLatency(void);
+
+	/**
+	 * Wait until every queued command is sent
+	 *
+	 * The worker then copies the link statistics for getLinkStats().
+	 */
+	void drain(void);
+
+	/**
+	 * Get link quality of a hand module
+	 *
+	 * Returns the copy taken by the last drain().
+	 *
+	 * @param  hand 	0 for right hand, 1 for left hand
+	 * @return      	link statistics
+	 */
+	LinkStats getLinkStats(int hand);
+
+	/**
+	 * Reset counters
+	 *
+	 * Waits for the queued commands, the link counters are cleared by the
+	 * worker.
+	 */
+	void resetStatistics(void);
+
+	/**
+	 * Print radio statistics
+	 *
+	 * Waits for the queued commands, so the report includes them.
+	 */
+	void printStatistics(void);
+};
+
+#endif
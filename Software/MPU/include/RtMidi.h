@@ -49,6 +49,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <atomic>
 
 /************************************************************************/
 /*! \class RtMidiError
@@ -210,6 +211,9 @@ class RtMidiIn : public RtMidi
   //! User callback function type definition.
   typedef void (*RtMidiCallback)( double timeStamp, std::vector<unsigned char> *message, void *userData);
 
+  //! Queue notifier function type definition.
+  typedef void (*RtMidiNotifier)( void *userData );
+
   //! Default constructor that allows an optional api, client name and queue size.
   /*!
     An exception will be thrown if a MIDI system initialization
@@ -278,6 +282,34 @@ class RtMidiIn : public RtMidi
   */
   void cancelCallback();
 
+  //! Set a function to be invoked after a message is written to the input queue.
+  /*!
+    The notifier runs on the input thread right after the message
+    becomes visible to getMessage().  It lets another thread sleep
+    until input arrives instead of polling the queue.  The notifier
+    must not block and must not call getMessage() itself.
+
+    \param notifier A notifier function, or NULL to remove it.
+    \param userData Optionally, a pointer passed to the notifier.
+  */
+  void setQueueNotifier( RtMidiNotifier notifier, void *userData = 0 );
+
+  //! Resize the input queue.
+  /*!
+    The queue can only be resized while no port is open.  Pending
+    messages are discarded.
+  */
+  void setQueueSizeLimit( unsigned int queueSizeLimit );
+
+  //! Return the number of messages waiting in the input queue.
+  unsigned int getQueueCount( void );
+
+  //! Return the number of messages dropped because the input queue was full.
+  unsigned long getQueueOverflowCount( void );
+
+  //! Return the number of sysex messages dropped because the sysex side queue was full.
+  unsigned long getSysexOverflowCount( void );
+
   //! Close an open MIDI connection (if one exists).
   void closePort( void );
 
@@ -408,6 +440,61 @@ class RtMidiOut : public RtMidi
   */
   void sendMessage( std::vector<unsigned char> *message );
 
+  //! Immediately send a single message out an open MIDI output port.
+  /*!
+      This overload sends raw bytes without building a vector.  An
+      exception is thrown if an error occurs during output or an
+      output connection was not previously established.
+
+      \param message A pointer to the MIDI message as raw bytes
+      \param size    Length of the MIDI message in bytes
+  */
+  void sendMessage( const unsigned char *message, size_t size );
+
+  //! Immediately send several messages out an open MIDI output port.
+  /*!
+      The messages are stored back to back in \e messages and the size
+      of each one is given in \e sizes.  Backends that buffer output
+      flush it once for the whole batch, which suits chords and other
+      events that share a timestamp.
+
+      \param messages Concatenated MIDI messages as raw bytes
+      \param sizes    Length of each message in bytes
+      \param count    Number of messages
+  */
+  void sendMessages( const unsigned char *messages, const size_t *sizes, size_t count );
+
+  //! Start a scheduling queue for timestamped output (Linux ALSA only).
+  /*!
+      Messages passed to scheduleMessages() are delivered by the
+      sequencer when the queue reaches their tick.  At a tempo scale
+      of 1.0 one tick lasts one microsecond.  Returns false if the
+      current API has no scheduling support or the queue could not be
+      created.
+
+      \param tempoScale Real time per tick, in microseconds
+  */
+  bool startQueue( double tempoScale = 1.0 );
+
+  //! Change the speed of a running scheduling queue without re-timestamping its events.
+  void setQueueTempo( double tempoScale );
+
+  //! Schedule several messages for delivery at the given queue tick.
+  /*!
+      The messages are stored back to back in \e messages and the size
+      of each one is given in \e sizes.
+  */
+  void scheduleMessages( const unsigned char *messages, const size_t *sizes, size_t count, unsigned int tick );
+
+  //! Return the current tick of the scheduling queue.
+  unsigned int getQueueTime( void );
+
+  //! Block until the sequencer has delivered every scheduled event.
+  void syncQueue( void );
+
+  //! Stop the scheduling queue and discard every event that has not been delivered yet.
+  void stopQueue( void );
+
   //! Set an error callback function to be invoked when an error has occured.
   /*!
     The callback function will be called whenever an error has occured. It is best
@@ -472,6 +559,11 @@ class MidiInApi : public MidiApi
   virtual ~MidiInApi( void );
   void setCallback( RtMidiIn::RtMidiCallback callback, void *userData );
   void cancelCallback( void );
+  void setQueueNotifier( RtMidiIn::RtMidiNotifier notifier, void *userData );
+  void setQueueSizeLimit( unsigned int queueSizeLimit );
+  unsigned int getQueueCount( void );
+  unsigned long getQueueOverflowCount( void );
+  unsigned long getSysexOverflowCount( void );
   virtual void ignoreTypes( bool midiSysex, bool midiTime, bool midiSense );
   double getMessage( std::vector<unsigned char> *message );
 
@@ -486,16 +578,43 @@ class MidiInApi : public MidiApi
   :bytes(0), timeStamp(0.0) {}
   };
 
+  // A lock-free ring written by the input thread and read by the
+  // getMessage() thread.  Channel messages are stored inline in the
+  // ring slots.  Longer messages (sysex) go through a small side ring
+  // of preallocated vectors, which keeps their order with the slots.
   struct MidiQueue {
-    unsigned int front;
-    unsigned int back;
-    unsigned int size;
+    enum { INLINE_SIZE = 3, SYSEX_RING_SIZE = 8, SYSEX_RESERVE = 256 };
+
+    struct Slot {
+      double timeStamp;
+      unsigned int size;
+      unsigned char bytes[INLINE_SIZE];
+    };
+
+    // Slot indices run from 0 to ringSize; one slot is always kept
+    // free to tell a full ring from an empty one.
+    std::atomic<unsigned int> front;
+    std::atomic<unsigned int> back;
     unsigned int ringSize;
-    MidiMessage *ring;
+    Slot *ring;
+
+    std::atomic<unsigned int> sysexFront;
+    unsigned int sysexBack;
+    std::vector<unsigned char> *sysexRing;
+
+    std::atomic<unsigned long> overflows;
+    std::atomic<unsigned long> sysexOverflows;
 
     // Default constructor.
   MidiQueue()
-  :front(0), back(0), size(0), ringSize(0) {}
+  :front(0), back(0), ringSize(0), ring(0), sysexFront(0), sysexBack(0),
+      sysexRing(0), overflows(0), sysexOverflows(0) {}
+
+    void allocate( unsigned int size );
+    void release( void );
+    unsigned int count( void );
+    bool push( const MidiMessage &message );
+    bool pop( std::vector<unsigned char> *message, double *timeStamp );
   };
 
   // The RtMidiInData structure is used to pass private class data to
@@ -511,12 +630,17 @@ class MidiInApi : public MidiApi
     RtMidiIn::RtMidiCallback userCallback;
     void *userData;
     bool continueSysex;
+    RtMidiIn::RtMidiNotifier notifier;
+    void *notifierData;
 
     // Default constructor.
   RtMidiInData()
   : ignoreFlags(7), doInput(false), firstMessage(true),
       apiData(0), usingCallback(false), userCallback(0), userData(0),
-      continueSysex(false) {}
+      continueSysex(false), notifier(0), notifierData(0) {}
+
+    // Queue a message and wake up the notifier, if any.
+    bool enqueue( const MidiMessage &message );
   };
 
  protected:
@@ -530,6 +654,14 @@ class MidiOutApi : public MidiApi
   MidiOutApi( void );
   virtual ~MidiOutApi( void );
   virtual void sendMessage( std::vector<unsigned char> *message ) = 0;
+  virtual void sendMessage( const unsigned char *message, size_t size );
+  virtual void sendMessages( const unsigned char *messages, const size_t *sizes, size_t count );
+  virtual bool startQueue( double tempoScale );
+  virtual void setQueueTempo( double tempoScale );
+  virtual void scheduleMessages( const unsigned char *messages, const size_t *sizes, size_t count, unsigned int tick );
+  virtual unsigned int getQueueTime( void );
+  virtual void syncQueue( void );
+  virtual void stopQueue( void );
 };
 
 // **************************************************************** //
@@ -545,6 +677,11 @@ inline void RtMidiIn :: closePort( void ) { rtapi_->closePort(); }
 inline bool RtMidiIn :: isPortOpen() const { return rtapi_->isPortOpen(); }
 inline void RtMidiIn :: setCallback( RtMidiCallback callback, void *userData ) { ((MidiInApi *)rtapi_)->setCallback( callback, userData ); }
 inline void RtMidiIn :: cancelCallback( void ) { ((MidiInApi *)rtapi_)->cancelCallback(); }
+inline void RtMidiIn :: setQueueNotifier( RtMidiNotifier notifier, void *userData ) { ((MidiInApi *)rtapi_)->setQueueNotifier( notifier, userData ); }
+inline void RtMidiIn :: setQueueSizeLimit( unsigned int queueSizeLimit ) { ((MidiInApi *)rtapi_)->setQueueSizeLimit( queueSizeLimit ); }
+inline unsigned int RtMidiIn :: getQueueCount( void ) { return ((MidiInApi *)rtapi_)->getQueueCount(); }
+inline unsigned long RtMidiIn :: getQueueOverflowCount( void ) { return ((MidiInApi *)rtapi_)->getQueueOverflowCount(); }
+inline unsigned long RtMidiIn :: getSysexOverflowCount( void ) { return ((MidiInApi *)rtapi_)->getSysexOverflowCount(); }
 inline unsigned int RtMidiIn :: getPortCount( void ) { return rtapi_->getPortCount(); }
 inline std::string RtMidiIn :: getPortName( unsigned int portNumber ) { return rtapi_->getPortName( portNumber ); }
 inline void RtMidiIn :: ignoreTypes( bool midiSysex, bool midiTime, bool midiSense ) { ((MidiInApi *)rtapi_)->ignoreTypes( midiSysex, midiTime, midiSense ); }
@@ -559,6 +696,14 @@ inline bool RtMidiOut :: isPortOpen() const { return rtapi_->isPortOpen(); }
 inline unsigned int RtMidiOut :: getPortCount( void ) { return rtapi_->getPortCount(); }
 inline std::string RtMidiOut :: getPortName( unsigned int portNumber ) { return rtapi_->getPortName( portNumber ); }
 inline void RtMidiOut :: sendMessage( std::vector<unsigned char> *message ) { ((MidiOutApi *)rtapi_)->sendMessage( message ); }
+inline void RtMidiOut :: sendMessage( const unsigned char *message, size_t size ) { ((MidiOutApi *)rtapi_)->sendMessage( message, size ); }
+inline void RtMidiOut :: sendMessages( const unsigned char *messages, const size_t *sizes, size_t count ) { ((MidiOutApi *)rtapi_)->sendMessages( messages, sizes, count ); }
+inline bool RtMidiOut :: startQueue( double tempoScale ) { return ((MidiOutApi *)rtapi_)->startQueue( tempoScale ); }
+inline void RtMidiOut :: setQueueTempo( double tempoScale ) { ((MidiOutApi *)rtapi_)->setQueueTempo( tempoScale ); }
+inline void RtMidiOut :: scheduleMessages( const unsigned char *messages, const size_t *sizes, size_t count, unsigned int tick ) { ((MidiOutApi *)rtapi_)->scheduleMessages( messages, sizes, count, tick ); }
+inline unsigned int RtMidiOut :: getQueueTime( void ) { return ((MidiOutApi *)rtapi_)->getQueueTime(); }
+inline void RtMidiOut :: syncQueue( void ) { ((MidiOutApi *)rtapi_)->syncQueue(); }
+inline void RtMidiOut :: stopQueue( void ) { ((MidiOutApi *)rtapi_)->stopQueue(); }
 inline void RtMidiOut :: setErrorCallback( RtMidiErrorCallback errorCallback, void *userData ) { rtapi_->setErrorCallback(errorCallback, userData); }
 
 // **************************************************************** //
@@ -681,9 +826,18 @@ class MidiOutAlsa: public MidiOutApi
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
   void sendMessage( std::vector<unsigned char> *message );
+  void sendMessage( const unsigned char *message, size_t size );
+  void sendMessages( const unsigned char *messages, const size_t *sizes, size_t count );
+  bool startQueue( double tempoScale );
+  void setQueueTempo( double tempoScale );
+  void scheduleMessages( const unsigned char *messages, const size_t *sizes, size_t count, unsigned int tick );
+  unsigned int getQueueTime( void );
+  void syncQueue( void );
+  void stopQueue( void );
 
  protected:
   void initialize( const std::string& clientName );
+  bool encodeMessage( const unsigned char *message, size_t size, bool scheduled = false, unsigned int tick = 0 );
 };
 
 #endif
@@ -0,0 +1,165 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <iostream>
+#include <ctime>
+#include <cerrno>
+
+/**
+ * Scheduler Class Interface
+ *
+ * Scheduler keeps the playback clock. Every event has an absolute deadline,
+ * measured in microseconds from the start of the session, and the scheduler
+ * sleeps until that deadline on CLOCK_MONOTONIC. Time spent sending MIDI
+ * messages or radio feedback is absorbed by the next sleep instead of being
+ * added to the song.
+ */
+class Scheduler
+{
+private:
+
+	/**
+	 * Session Start Time
+	 */
+	struct timespec origin;
+
+	/**
+	 * Number of events waited for
+	 */
+	long events;
+
+	/**
+	 * Number of events that missed their deadline
+	 */
+	long lateEvents;
+
+	/**
+	 * Largest lateness in microseconds
+	 */
+	long long maxLateness;
+
+	/**
+	 * Sum of lateness in microseconds
+	 */
+	long long totalLateness;
+
+public:
+
+	/**
+	 * Scheduler Class Constructor
+	 */
+	Scheduler();
+
+	/**
+	 * Start Session Clock
+	 *
+	 * Set the session origin to the current time and reset the statistics
+	 */
+	void start(void);
+
+	/**
+	 * Start Session Clock at a Given Time
+	 *
+	 * Set the session origin so that the given time has already elapsed,
+	 * to share the origin of another clock
+	 *
+	 * @param elapsed 	session time in microseconds
+	 */
+	void start(long long elapsed);
+
+	/**
+	 * Get Session Time
+	 *
+	 * @return  microseconds elapsed since the session origin
+	 */
+	long long now(void);
+
+	/**
+	 * Get Monotonic Time
+	 *
+	 * Convert an offset from the session origin to CLOCK_MONOTONIC time, so
+	 * other waits can share the playback deadlines.
+	 *
+	 * @param  offset 	offset in microseconds from the session origin
+	 * @return        	CLOCK_MONOTONIC time in microseconds
+	 */
+	long long getMonotonicTime(long long offset);
+
+	/**
+	 * Wait Until Deadline
+	 *
+	 * Sleep until the given offset from the session origin has passed.
+	 *
+	 * @param  deadline 	deadline in microseconds from the session origin
+	 * @return          	lateness in microseconds
+	 */
+	long long waitUntil(long long deadline);
+
+	/**
+	 * Get Event Count
+	 *
+	 * @return  number of events waited for
+	 */
+	long getEventCount(void);
+
+	/**
+	 * Get Late Event Count
+	 *
+	 * @return  number of events that missed their deadline
+	 */
+	long getLateEventCount(void);
+
+	/**
+	 * Get Maximum Lateness
+	 *
+	 * @return  maximum lateness in microseconds
+	 */
+	long long getMaxLateness(void);
+
+	/**
+	 * Get Mean Lateness
+	 *
+	 * @return  mean lateness in microseconds
+	 */
+	double getMeanLateness(void);
+
+	/**
+	 * Print Timing Statistics
+	 */
+	void printStatistics(void);
+};
+
+#endif
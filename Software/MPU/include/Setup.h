@@ -35,12 +35,17 @@
 #define _SETUP_H_
 
 #include <iostream>
+#include <string>
+#include <sstream>
 #include <tclap/CmdLine.h>
 #include <wiringPi.h>
 
 #include "MidiIO.h"
 #include "ORF24.h"
+#include "RadioService.h"
 #include "WiringPiKeypad.h"
+#include "EvdevKeypad.h"
+#include "InputService.h"
 
 /**
  * A structure to contain command line arguments
@@ -48,6 +53,13 @@
 struct Args {
 	bool debugEnabled;
 	bool keyboardEnabled;
+	bool queueEnabled;
+	int radioIRQPin;
+	int radioCEPin;
+	std::string keypadRowPins;
+	int radioIdleTimeout;
+	int radioChannel;
+	bool legacyFeedback;
 };
 
 /**
@@ -56,7 +68,9 @@ struct Args {
 struct Container {
 	MidiIO *io;
 	ORF24 *rf;
-	WiringPiKeypad *keypad;
+	RadioService *radio;
+	Keypad *keypad;
+	InputService *input;
 };
 
 /**
@@ -100,4 +114,25 @@ int radioSetup(struct Container *container, struct Args *args);
  */
 int keypadSetup(struct Container *container, struct Args *args);
 
+/**
+ * Parse a comma separated pin list
+ * 
+ * @param  list 	pin list
+ * @param  pins 	pin container
+ * @param  count 	number of pins expected
+ * @return       	true if exactly count pins were read
+ */
+bool parsePinList(std::string list, int *pins, int count);
+
+/**
+ * Setup keyboard
+ *
+ * A USB numpad or keyboard replaces the keypad matrix. Digits and A-D map
+ * to themselves, the numpad operators map to A-D, dot to '*' and enter
+ * to '#'.
+ * 
+ * @return  status
+ */
+int keyboardSetup(struct Container *container, struct Args *args);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,170 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+#include <atomic>
+
+/**
+ * SpscQueue Class Interface
+ *
+ * A lock-free ring buffer for exactly one producer thread and one consumer
+ * thread. Capacity must be a power of two. Push and pop never block, so the
+ * queue is safe to use from timing-critical loops.
+ */
+template <typename T, unsigned int Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+private:
+
+	/**
+	 * Ring storage
+	 */
+	T ring[Capacity];
+
+	/**
+	 * Next slot to read, owned by the consumer
+	 */
+	std::atomic<unsigned int> head;
+
+	/**
+	 * Keep head and tail on separate cache lines
+	 */
+	char padding[64];
+
+	/**
+	 * Next slot to write, owned by the producer
+	 */
+	std::atomic<unsigned int> tail;
+
+public:
+
+	/**
+	 * SpscQueue Class Constructor
+	 */
+	SpscQueue() : head(0), tail(0) { }
+
+	/**
+	 * Push item to the queue
+	 *
+	 * Must only be called from the producer thread.
+	 *
+	 * @param  item 	item to push
+	 * @return      	false if the queue is full
+	 */
+	bool push(const T &item)
+	{
+		unsigned int t = tail.load(std::memory_order_relaxed);
+
+		if (t - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		ring[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * Pop item from the queue
+	 *
+	 * Must only be called from the consumer thread.
+	 *
+	 * @param  item 	item container
+	 * @return      	false if the queue is empty
+	 */
+	bool pop(T *item)
+	{
+		unsigned int h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+
+		*item = ring[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * Peek at the next item without removing it
+	 *
+	 * Must only be called from the consumer thread.
+	 *
+	 * @return  pointer to the next item, or null if the queue is empty
+	 */
+	T *front(void)
+	{
+		unsigned int h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire))
+			return 0;
+
+		return &ring[h & (Capacity - 1)];
+	}
+
+	/**
+	 * Get number of queued items
+	 *
+	 * @return  queue depth
+	 */
+	unsigned int size(void)
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Check whether the queue is empty
+	 *
+	 * @return  true if empty
+	 */
+	bool empty(void)
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * Get queue capacity
+	 *
+	 * @return  capacity
+	 */
+	unsigned int capacity(void)
+	{
+		return Capacity;
+	}
+};
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#ifndef _TEMPO_MAP_H_
+#define _TEMPO_MAP_H_
+
+#include <vector>
+#include <algorithm>
+
+#include "MidiFile.h"
+
+/**
+ * Default MIDI tempo, 120 BPM in microseconds per quarter note
+ */
+#define		DEFAULT_TEMPO		500000
+
+/**
+ * A tempo segment starts at a Set Tempo meta event and lasts until the next one
+ */
+struct TempoSegment
+{
+	long tick;				/* Absolute tick where the segment starts */
+	long long time;			/* Segment start time in microseconds */
+	long tempo;				/* Microseconds per quarter note */
+};
+
+/**
+ * TempoMap Class Interface
+ *
+ * TempoMap converts absolute ticks into microseconds. It is built once per
+ * song from every Set Tempo (FF 51) meta event in every track, so the player
+ * and the evaluator do not need to do floating-point math for each event.
+ */
+class TempoMap
+{
+private:
+
+	/**
+	 * Ticks per quarter note
+	 */
+	int tpq;
+
+	/**
+	 * Tempo segments, sorted by tick
+	 */
+	std::vector<TempoSegment> segments;
+
+	/**
+	 * Convert tick inside a segment to microseconds
+	 *
+	 * @param  s    	segment index
+	 * @param  tick 	absolute tick
+	 * @return      	time in microseconds
+	 */
+	long long toMicroseconds(int s, long tick);
+
+public:
+
+	/**
+	 * TempoMap Class Constructor
+	 */
+	TempoMap();
+
+	/**
+	 * Build Tempo Map
+	 *
+	 * @param midi 	MIDI file handler
+	 */
+	void build(MidiFile *midi);
+
+	/**
+	 * Get Time of Tick
+	 *
+	 * Look the segment up with a binary search.
+	 *
+	 * @param  tick 	absolute tick
+	 * @return      	time in microseconds
+	 */
+	long long getMicroseconds(long tick);
+
+	/**
+	 * Get Time of Tick Using Cursor
+	 *
+	 * The cursor remembers the last segment, so walking the song forward
+	 * costs O(1) per lookup. Start with a cursor of 0.
+	 *
+	 * @param  tick   	absolute tick
+	 * @param  cursor 	segment cursor
+	 * @return        	time in microseconds
+	 */
+	long long getMicroseconds(long tick, int *cursor);
+
+	/**
+	 * Get Segment Count
+	 *
+	 * @return  number of tempo segments
+	 */
+	int getSegmentCount(void);
+};
+
+#endif
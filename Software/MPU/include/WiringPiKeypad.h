@@ -23,20 +23,23 @@
  * 
  */
 
-#ifndef _KEYPAD_H_
-#define _KEYPAD_H_
+#ifndef _WIRINGPI_KEYPAD_H_
+#define _WIRINGPI_KEYPAD_H_
 
 #include <iostream>
 #include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
 #include <wiringPi.h>
 
-struct key
-{
-	int row;
-	int column;
-};
+#include "Keypad.h"
+#include "GpioLines.h"
 
-class WiringPiKeypad
+#define		SCAN_SETTLE_DELAY	10
+
+class WiringPiKeypad : public Keypad
 {
 protected:
 	int rowSize;
@@ -46,6 +49,28 @@ protected:
 	std::vector<std::vector<char>> matrix;
 	int debounceDelay;
 	int pollingDelay;
+	bool edgeScan = false;
+	unsigned long edgeCount = 0;
+	unsigned long edgeSeen = 0;
+	unsigned int lastEdge = 0;
+	long long lastEdgeTime = 0;
+	unsigned int lastChange = 0;
+	bool edgePending = false;
+	std::mutex edgeMutex;
+	std::condition_variable edgeSignal;
+	static WiringPiKeypad *edgeInstance;
+	GpioLines rowLines;
+	GpioLines columnLines;
+
+	void armRows(void);
+	int scan(struct key *keys, int max);
+	int scanLines(struct key *keys, int max);
+	bool waitEdge(std::unique_lock<std::mutex> &lock, int timeout);
+	char getSymbol(struct key k);
+	bool getEdgeEvent(struct KeyEvent *event, const std::atomic<bool> *terminator);
+	bool getPolledEvent(struct KeyEvent *event, const std::atomic<bool> *terminator);
+	void onEdge(void);
+	static void edgeHandler(void);
 
 public:
 	WiringPiKeypad(int _rowSize, int _columnSize);
@@ -53,14 +78,20 @@ public:
 	void setRowPin(int *row);
 	void setColumnPin(int *column);
 	void setMatrix(std::vector<std::vector<char>> m);
+	void begin(void);
+	bool enableEdgeScan(void);
+	bool isEdgeScanEnabled(void);
+	bool enableGpioChip(const char *chip);
+	bool isGpioChipEnabled(void);
 	void setDebounceDelay(int delay);
 	void setPollingDelay(int delay);
 	int getDebounceDelay(void);
 	int getPollingDelay(void);
 	struct key getRawKey(void);
-	struct key getRawKey(bool *terminator);
+	struct key getRawKey(const std::atomic<bool> *terminator);
 	char getKey(void);
-	char getKey(bool *terminator);
+	char getKey(const std::atomic<bool> *terminator);
+	bool getEvent(struct KeyEvent *event, const std::atomic<bool> *terminator);
 	bool inputIs(int row, int column);
 	bool inputIs(struct key keypress, int row, int column);
 	void printDetails(void);
@@ -163,4 +163,7 @@ enum DataRate {RF_DR_1MBPS = 0, RF_DR_2MBPS};
 /* RF Output Power */
 enum RFPower {RF_PA_MIN = 0, RF_PA_LOW, RF_PA_HIGH, RF_PA_MAX};
 
+/* Power Policy */
+enum PowerPolicy {POWER_DOWN_AFTER_WRITE = 0, STANDBY_IN_SESSION};
+
 #endif
\ No newline at end of file
@@ -70,12 +70,11 @@ void startRoutine(Container *container)
 {
 	char keypress;
 	std::string songPath;
-	WiringPiKeypad *keypad = container->keypad;
 
 	while (1)
 	{
 		showMenu();
-		keypress = keypad->getKey();
+		keypress = container->input->getKey();
 
 		if (keypress == SELECT_SONG_BUTTON)
 		{
@@ -161,27 +160,35 @@ void printSongList(std::ifstream *songList)
 /**
  * Select Song
  *
- * This method will ask the user to choose from opened song list
+ * This method will ask the user to choose from opened song list. The
+ * number is confirmed with the select button, or by holding its last digit.
  * 
  * @param  songList song list handler
  * @return          song name
  */
 std::string selectSong(Container *container, std::ifstream *songList)
 {
-	std::cout << "Press number to select song. Press '*' to select." << std::endl;
+	std::cout << "Press number to select song. Press 'A' or hold the last digit to select." << std::endl;
 
-	char keypress;
+	struct KeyEvent event;
 	std::string songNumber;
-	WiringPiKeypad *keypad = container->keypad;
+	KeySubscription *keys = container->input->subscribe();
 
-	do
+	while (keys && keys->wait(&event, -1))
 	{
-		keypress = keypad->getKey();
-		songNumber += keypress;
-	} while (keypress != SELECT_SONG_BUTTON);
+		bool digit = event.key >= '0' && event.key <= '9';
+
+		if (event.type == KEYPAD_DOWN && event.key == SELECT_SONG_BUTTON)
+			break;
+		else if (event.type == KEYPAD_DOWN && digit)
+			songNumber += event.key;
+		else if (event.type == KEYPAD_LONG_PRESS && digit)
+			break;
+	}
+
+	container->input->unsubscribe(keys);
 
-	songNumber.pop_back(); // Remove 'A' from songNumber
-	int number = std::stoi(songNumber);
+	int number = songNumber.empty() ? 0 : std::stoi(songNumber);
 	songList->clear();
 	songList->seekg(0, std::ios::beg);
 
@@ -207,16 +214,19 @@ void startMPA(Container *container, std::string songPath, MPUOperation operation
 	MidiFile midi(songPath + ".mid");
 	FingerData finger(songPath + ".fgr");
 
-	PlayMode mode = getPlayMode(container->keypad);
+	PlayMode mode = getPlayMode(container->input);
 	setPlayMode(&midi, mode);
 
+	TempoMap tempoMap;
+	tempoMap.build(&midi);
+
 	if (operation == PLAYER)
 	{
 		std::cout << "Playing song \"" + songPath + "\"..." << std::endl;
 		if (container->io->openMidiOutPort())
 			return;
 
-		play(container, &midi, &finger, mode);
+		play(container, &midi, &finger, &tempoMap, mode);
 		container->io->closeMidiOutPort();
 	}
 	else
@@ -226,7 +236,7 @@ void startMPA(Container *container, std::string songPath, MPUOperation operation
 		if (container->io->openMidiInPort()) return;
 		if (container->io->openMidiOutPort()) return;
 
-		evaluate(container, &midi, &finger, mode);
+		evaluate(container, &midi, &finger, &tempoMap, mode);
 		container->io->closeMidiInPort();
 		container->io->closeMidiOutPort();
 	}
@@ -241,49 +251,195 @@ void startMPA(Container *container, std::string songPath, MPUOperation operation
  * @param  container hardware handler
  * @param  midi 	 MIDI file handler
  * @param  finger 	 finger data handler
+ * @param  tempoMap  song tempo map
  * @param  mode 	 selected play mode
  */
-void play(Container *container, MidiFile *midi, FingerData *finger, PlayMode mode)
+void play(Container *container, MidiFile *midi, FingerData *finger, TempoMap *tempoMap, PlayMode mode)
 {
-	int tpq = midi->getTicksPerQuarterNote();
-	double spt = 0.5 / tpq;
-	int t = (mode == LEFT_HAND) ? 1 : 0;
-	std::vector<char> f(2, 0);
-
 	std::cout << "Enter Tempo Modifier: " << std::endl;
-	int tempo = container->keypad->getKey() - '0';
+	int tempo = container->input->getKey() - '0';
 	tempo = tempo > 2 ? 1 : tempo;
 
-	char keypress;
-	bool terminator = true;
-	std::thread input(keypadHandler, container->keypad, &keypress, &terminator);
+	std::vector<PlaybackEvent> plan;
+	compilePlaybackPlan(midi, finger, tempoMap, mode, &plan);
+	unsigned char frame[MAX_FRAME_SIZE * 3];
+	size_t sizes[MAX_FRAME_SIZE];
+	Scheduler scheduler;
+	container->radio->resetStatistics();
+	container->radio->beginSession();
+
+	KeySubscription *keys = container->input->subscribe();
 
 	delay(1000);
-	for (int e = 0; e < (*midi)[t].getSize(); e++)
+	bool queued = container->io->isQueueEnabled() && !container->io->startQueue(tempo);
+	bool stopped = false;
+	unsigned int q = 0;
+
+	// The sequencer queue is the song clock, the scheduler follows it
+	if (queued)
+		scheduler.start(container->io->getQueueTime() * tempo);
+	else
+		scheduler.start();
+	size_t count;
+
+	for (unsigned int i = 0; i < plan.size(); )
+	{
+		unsigned int first = i;
+		long long time = plan[i].time;
+
+		if (queued)
+		{
+			// Keep the sequencer queue filled a window ahead
+			while (q < plan.size() && plan[q].time <= time + QUEUE_WINDOW)
+			{
+				long long at = plan[q].time;
+				q = getFrame(&plan, q, frame, sizes, &count);
+				container->io->scheduleMessages(frame, sizes, count, at);
+			}
+
+			while (i < plan.size() && plan[i].time == time)
+				i++;
+		}
+
+		// Sleep on the keypad until the deadline so stop is seen at once
+		if (waitForStop(keys, scheduler.getMonotonicTime(time * tempo)))
+		{
+			stopped = true;
+			break;
+		}
+
+		scheduler.waitUntil(time * tempo);
+
+		if (!queued)
+		{
+			i = getFrame(&plan, i, frame, sizes, &count);
+			container->io->sendMessages(frame, sizes, count);
+		}
+
+		// One vibrator command per hand for the whole chord
+		unsigned short motors[2] = {0, 0};
+
+		for (unsigned int j = first; j < i; j++)
+		{
+			PlaybackEvent *e = &plan[j];
+
+			if (e->noteOn)
+				motors[e->hand] |= e->motors;
+		}
+
+		for (int hand = 0; hand < 2; hand++)
+		{
+			if (motors[hand])
+				container->radio->sendMotors(hand, motors[hand], true);
+		}
+	}
+
+	container->input->unsubscribe(keys);
+	if (queued)
 	{
-		delayMicroseconds(spt * midi->getEvent(t, e).tick * 1000000 * tempo);
-		if (midi->getEvent(t, e).isMeta())
+		// Let the last scheduled notes out unless the user stopped the song
+		if (!stopped)
+			container->io->syncQueue();
+
+		container->io->stopQueue();
+	}
+	container->radio->endSession();
+	scheduler.printStatistics();
+	container->radio->printStatistics();
+}
+
+/**
+ * Get Playback Frame
+ *
+ * This function collects the MIDI messages of the events sharing the
+ * timestamp of plan[i] into one frame, up to MAX_FRAME_SIZE messages
+ *
+ * @param  plan   	playback plan
+ * @param  i      	index of the first event
+ * @param  frame  	frame container, MAX_FRAME_SIZE * 3 bytes
+ * @param  sizes  	message sizes container, MAX_FRAME_SIZE elements
+ * @param  count  	number of messages in the frame
+ * @return        	index of the first event after the frame
+ */
+unsigned int getFrame(std::vector<PlaybackEvent> *plan, unsigned int i, unsigned char *frame, size_t *sizes, size_t *count)
+{
+	long long time = plan->at(i).time;
+	unsigned char *p = frame;
+
+	*count = 0;
+
+	for (; i < plan->size() && (*plan)[i].time == time && *count < MAX_FRAME_SIZE; i++)
+	{
+		PlaybackEvent *e = &(*plan)[i];
+
+		if (!e->size)
 			continue;
-		sendMidiMessage(container->io, midi->getEvent(t, e));
- 
- 		if (midi->getEvent(t, e).isNoteOn())
- 		{
-	 		int ft = (mode == BOTH_HANDS) ? midi->getSplitTrack(t, e) : t;
-			sendFeedback(container->rf, finger->getData(ft, f[ft]), ft, true);
-			sendFeedback(container->rf, finger->getData(ft, f[ft]++), ft, false);
- 		}
-
- 		switch (keypress)
- 		{
- 			case STOP_BUTTON:
- 				keypress = 0;
- 				input.join();
- 				return;
- 		}
+
+		memcpy(p, e->message, e->size);
+		p += e->size;
+		sizes[(*count)++] = e->size;
 	}
 
-	terminator = false;
-	input.join();
+	return i;
+}
+
+/**
+ * Compile Playback Plan
+ *
+ * This function flattens the played track into a contiguous array of
+ * events with absolute times, raw MIDI bytes and precomputed feedback
+ * payloads, so the playback loop does not touch the MIDI file at all.
+ * The plan has one record per MIDI event, in the same order.
+ *
+ * @param midi     MIDI file handler
+ * @param finger   finger data handler
+ * @param tempoMap song tempo map
+ * @param mode     selected play mode
+ * @param plan     plan container
+ */
+void compilePlaybackPlan(MidiFile *midi, FingerData *finger, TempoMap *tempoMap, PlayMode mode, std::vector<PlaybackEvent> *plan)
+{
+	int t = (mode == LEFT_HAND) ? 1 : 0;
+	std::vector<int> f(2, 0);
+	long tick = 0;
+	int cursor = 0;
+
+	plan->clear();
+	plan->reserve((*midi)[t].getSize());
+
+	for (int i = 0; i < (*midi)[t].getSize(); i++)
+	{
+		MidiEvent &event = midi->getEvent(t, i);
+		PlaybackEvent e = {};
+
+		tick += event.tick;
+		e.time = tempoMap->getMicroseconds(tick, &cursor);
+
+		if (!event.isMeta() && event.size() <= sizeof(e.message))
+		{
+			e.size = event.size();
+			for (unsigned int b = 0; b < e.size; b++)
+				e.message[b] = event[b];
+		}
+
+		if (event.isNoteOn())
+		{
+			int ft = (mode == BOTH_HANDS) ? midi->getSplitTrack(t, i) : t;
+			char data = finger->getData(ft, f[ft]++);
+
+			e.noteOn = true;
+			e.hand = ft;
+			e.finger = data;
+			for (int side = 0; side < 2; side++)
+			{
+				int motor = getFeedbackMotor(data, ft, side == 0);
+				if (motor >= 0)
+					e.motors |= 1 << motor;
+			}
+		}
+
+		plan->push_back(e);
+	}
 }
 
 /**
@@ -294,117 +450,149 @@ void play(Container *container, MidiFile *midi, FingerData *finger, PlayMode mod
  * @param container handware handler
  * @param midi      MIDI file handler
  * @param finger    finger data handler
+ * @param tempoMap  song tempo map
  * @param mode      selected play mode
  */
-void evaluate(Container *container, MidiFile *midi, FingerData *finger, PlayMode mode)
+void evaluate(Container *container, MidiFile *midi, FingerData *finger, TempoMap *tempoMap, PlayMode mode)
 {
-	int t = (mode == LEFT_HAND) ? 1 : 0;
-	int m = 0;
-	std::vector<char> f(2, 0);
-	bool status = true;
+	Chord chord;
+	std::vector<PlaybackEvent> plan;
+	std::vector<ChordEntry> chords;
+	std::vector<Key> keys;
 
-	char keypress;
-	bool terminator = true;
-	std::thread input(keypadHandler, container->keypad, &keypress, &terminator);
+	compilePlaybackPlan(midi, finger, tempoMap, mode, &plan);
+	compileChordIndex(midi, &plan, mode, &chords, &keys);
+	container->radio->resetStatistics();
+	container->radio->beginSession();
 
-	while (status)
+	KeySubscription *commands = container->input->subscribe(interruptOnCommand, container->io);
+
+	for (unsigned int c = 0; c < chords.size(); c++)
 	{
-		std::vector<Key> keys;
-		int mBefore = m;
-		status = getUnisonNote(midi, &m, t, &keys);
-		getUnisonFinger(finger, &f, &keys);
-		getInputAndEvaluate(container, keys, &keypress, midi, mBefore, t);
-
-		switch (keypress)
- 		{
- 			case STOP_BUTTON:
- 				keypress = 0;
- 				input.join();
- 				return;
- 		}
+		ChordEntry *entry = &chords[c];
+		buildChord(&keys[entry->offset], entry->count, &chord);
+
+		char command = getInputAndEvaluate(container, &chord, commands, &plan, entry->event);
+
+		if (command == STOP_BUTTON)
+			break;
+		else if (command == SKIP_BUTTON)
+			std::cout << "Skipped chord " << c + 1 << "." << std::endl;
 	}
 
-	terminator = false;
-	input.join();
+	container->input->unsubscribe(commands);
+	container->radio->endSession();
+	container->radio->printStatistics();
 }
 
 /**
- * Get Unison Note
+ * Compile Chord Index
  *
- * This function groups note played at the same time
- * 
- * @param  midi MIDI file handler
- * @param  m    MIDI file index
- * @param  t    MIDI track number
- * @param  keys Keys container
- * @return      status
+ * This function groups the note ons of the evaluated track into chords,
+ * a new chord starting at every event with a non-zero delta tick. The keys
+ * of all chords are stored back to back, so the evaluator steps through
+ * the song without touching the MIDI file.
+ *
+ * @param midi   MIDI file handler
+ * @param plan   playback plan of the track
+ * @param mode   selected play mode
+ * @param chords chord index container
+ * @param keys   chord keys container
  */
-bool getUnisonNote(MidiFile *midi, int *m, int t, std::vector<Key> *keys)
+void compileChordIndex(MidiFile *midi, std::vector<PlaybackEvent> *plan, PlayMode mode, std::vector<ChordEntry> *chords, std::vector<Key> *keys)
 {
-	bool status = true;
-	do
+	int t = (mode == LEFT_HAND) ? 1 : 0;
+
+	chords->clear();
+	keys->clear();
+
+	for (int i = 0; i < (*midi)[t].getSize(); i++)
 	{
-		Key key;
+		MidiEvent &event = midi->getEvent(t, i);
+		PlaybackEvent *e = &plan->at(i);
 
-		if (midi->getEvent(t, *m).isNoteOn())
+		if (i == 0 || event.tick != 0)
 		{
-			key.track = midi->getSplitTrack(t, *m);
-			key.note = midi->getEvent(t, *m)[1];
-			keys->push_back(key);
-		}
-		*m += 1;
+			if (!chords->empty() && chords->back().count == 0)
+				chords->pop_back();
 
-		if (*m >= (*midi)[0].size())
-			status = false;
+			ChordEntry chord = {(int) keys->size(), 0, i};
+			chords->push_back(chord);
+		}
 
-	} while (midi->getEvent(t, *m).tick == 0 && status);
+		if (e->noteOn)
+		{
+			Key key;
+			key.track = e->hand;
+			key.note = e->message[1];
+			key.finger = e->finger;
+			keys->push_back(key);
+			chords->back().count++;
+		}
+	}
 
-	return status;
+	if (!chords->empty() && chords->back().count == 0)
+		chords->pop_back();
 }
 
 /**
- * Get Unison Finger
- * This function groups finger played at the same time
+ * Build Chord
+ *
+ * This function turns a group of keys into a pitch set for matching
  * 
- * @param finger finger data handler
- * @param f      finger data index
- * @param keys   Keys container
+ * @param keys   first key of the chord
+ * @param count  number of keys
+ * @param chord  chord container
  */
-void getUnisonFinger(FingerData *finger, std::vector<char> *f, std::vector<Key> *keys)
+void buildChord(const Key *keys, int count, Chord *chord)
 {
-	for(unsigned int i = 0; i < keys->size(); i++)
+	chord->pending.clear();
+
+	for (int i = 0; i < count; i++)
 	{
-		int t = keys->at(i).track;
-		keys->at(i).finger = finger->getData(t, f->at(t));
-		f->at(t) += 1;
+		const Key *key = &keys[i];
+		chord->pending.insert(key->note);
+		chord->finger[key->note] = key->finger;
+		chord->track[key->note] = key->track;
 	}
 }
 
 /**
  * Get MIDI Input
  * 
+ * This function blocks on the MIDI input until a note arrives or a keypad
+ * command interrupts the wait
+ * 
  * @param io       MIDI IO handler
- * @param expected number of expected input
+ * @param chord    expected notes
+ * @param keys     keypad subscription
+ * @param plan     playback plan of the track
+ * @param m        plan index of the current chord
+ * @return         STOP_BUTTON or SKIP_BUTTON if interrupted, 0 otherwise
  */
-void getInputAndEvaluate(Container *container, std::vector<Key> keys, char *keypress, MidiFile *midi, int m, int t)
+char getInputAndEvaluate(Container *container, Chord *chord, KeySubscription *keys, std::vector<PlaybackEvent> *plan, int m)
 {
-	unsigned int i = 0;
 	int cWrong = 0;
 
-	while (i < keys.size() && *keypress != STOP_BUTTON)
+	while (!chord->pending.empty())
 	{
+		char command = getCommand(keys);
+
+		if (command)
+			return command;
+
 		std::vector<unsigned char> message;
-		container->io->getMessage(&message);
+		container->io->waitMessage(&message);
 
 		if (message.size() > 0)
 		{
  			if (message[0] == 0x90)
 			{
-				if (! compare(container->rf, &keys, message[1]))
+				if (! compare(container->radio, chord, message[1]))
 				{
 					printf("Wrong.\nExpected: ");
-					for (unsigned int i = 0; i < keys.size(); i++)
-						printf("%X ", keys[i].note);
+					for (int n = chord->pending.above(0); n != NO_PITCH; n = chord->pending.above(n + 1))
+						printf("%X ", n);
 					
 					printf("\nReceived: %X\n", message[1]);
 					cWrong++;
@@ -414,56 +602,57 @@ void getInputAndEvaluate(Container *container, std::vector<Key> keys, char *keyp
 			if (cWrong > 2)
 			{
 				int lim = m + 4;
+				Scheduler scheduler;
 				delay(300);
-				for (int e = m; e < lim; e++)
+				scheduler.start();
+				for (int i = m; i < lim && i < (int) plan->size(); i++)
 				{
-					delayMicroseconds((0.5 / midi->getTicksPerQuarterNote()) * midi->getEvent(t, e).tick * 1000000);
+					PlaybackEvent *e = &plan->at(i);
+					scheduler.waitUntil(e->time - plan->at(m).time);
 					
-					if (!midi->getEvent(t, e).isNoteOn())
+					if (!e->noteOn)
 						lim++;
-					if (midi->getEvent(t, e).isMeta())
+					if (!e->size)
 						continue;
 
-					sendMidiMessage(container->io, midi->getEvent(t, e));
+					container->io->sendMessage(e->message, e->size);
 				}
 				cWrong = 0;
 			}
 		}
-
-		delay(10);
 	}
+
+	return 0;
 }
 
 /**
  * Compare MIDI Input with MIDI Data
  *
- * @param  rf 	Trasceiver handler
- * @param  keys MIDI Data
- * @param  note MIDI Input
- * @return      Compare result
+ * A matched note is removed from the chord. On a wrong note, only the
+ * finger of the nearest expected note gets a feedback.
+ *
+ * @param  radio 	radio service handler
+ * @param  chord 	MIDI Data
+ * @param  note 	MIDI Input
+ * @return      	Compare result
  */
-bool compare(ORF24 *rf, std::vector<Key> *keys, unsigned char note)
+bool compare(RadioService *radio, Chord *chord, unsigned char note)
 {
-	bool wrong = true;
-	bool right = true;
+	if (chord->pending.contains(note))
+	{
+		chord->pending.erase(note);
+		return true;
+	}
+
+	int nearest = chord->pending.nearest(note);
 
-	for (unsigned int i = 0; i < keys->size(); i++)
+	if (nearest != NO_PITCH)
 	{
-		if (keys->at(i).note != note)
-		{
-			wrong = true;
-			right = (note > keys->at(i).note) ? true : false;  
-			sendFeedback(rf, keys->at(i).finger, keys->at(i).track, right);			
-		}
-		else
-		{
-			wrong = false;
-			keys->erase(keys->begin() + i);
-			break;
-		}
+		bool right = note > nearest;
+		sendFeedback(radio, chord->finger[nearest], chord->track[nearest], right);
 	}
 
-	return !wrong;
+	return false;
 }
 
 /**
@@ -471,10 +660,10 @@ bool compare(ORF24 *rf, std::vector<Key> *keys, unsigned char note)
  *
  * This function ask the user to select the play mode
  * 
- * @param  keypad 	keypad handler
+ * @param  input 	input service handler
  * @return          play mode
  */
-PlayMode getPlayMode(WiringPiKeypad *keypad)
+PlayMode getPlayMode(InputService *input)
 {
 	std::cout << "Select Play Mode." << std::endl
 			  << " 1 - Both hands" << std::endl
@@ -484,7 +673,7 @@ PlayMode getPlayMode(WiringPiKeypad *keypad)
 	char keypress;
 	PlayMode mode = BOTH_HANDS;
 
-	keypress = keypad->getKey();
+	keypress = input->getKey();
 
 	if (keypress == BOTH_HANDS_MODE_BUTTON)
 		mode = BOTH_HANDS;
@@ -513,68 +702,44 @@ void setPlayMode(MidiFile *midi, PlayMode mode)
 }
 
 /**
- * Get Tempo in Second Per Tick
- * 	
- * @param e   	MidiEvent
- * @param tpq 	tick peq quarter
- * @param spt 	second per tick
- */
-void getTempoSPT(MidiEvent e, int tpq, double *spt)
-{
-	if (e.getTempoSPT(tpq) > 0)
-		*spt = e.getTempoSPT(tpq);
-}
-
-/**
- * Send MIDI Message
+ * Send Feedback to Hand Module
  *
- * This method will form a MIDI message container and send it to MIDI output port
+ * This method queues a payload for the radio service to send to hand module
  * 
- * @param io MIDI i/O port
- * @param e  MIDI event
+ * @param radio 	radio service handler
+ * @param f  		finger data
+ * @param t  		active track
+ * @param right 	turn on right vibrator. If false, then turn on left vibrator
  */
-void sendMidiMessage(MidiIO *io, MidiEvent e)
+void sendFeedback(RadioService *radio, char f, int t, bool right)
 {
-	std::vector<unsigned char> message;
-
-	for (unsigned int i = 0; i < e.size(); i++)
-		message.push_back((int) e[i]);
+	int motor = getFeedbackMotor(f, t, right);
 
-	io->sendMessage(&message);
+	if (motor >= 0)
+		radio->sendMotors(t, 1 << motor, true);
 }
 
 /**
- * Send Feedback to Hand Module
+ * Get Feedback Motor
  *
- * This method use the radio transceiver to send payload to hand module
+ * This method finds the hand module vibrator of a finger
  * 
- * @param rf 		radio handler
- * @param f  		finger data
- * @param t  		active track
- * @param right 	turn on right vibrator. If false, then turn on left vibrator
+ * @param  f  		finger data
+ * @param  t  		active track
+ * @param  right 	right vibrator. If false, then left vibrator
+ * @return       	motor number, -1 if the finger is unknown
  */
-void sendFeedback(ORF24 *rf, char f, int t, bool right)
+int getFeedbackMotor(char f, int t, bool right)
 {
-	const unsigned char command = 0x90;
-	unsigned char payload = 0;
-
-	if (t) // Left hand
-	{
-		rf->openWritingPipe("ArS02");
-	}
-	else // Right hand
+	if (!t) // Right hand
 	{
 		f = inverse(f);
-		rf->openWritingPipe("ArS01");
 	}
-	// printf("Feedback: %X %X\n", t, f);
 
-	if (right)
-		payload = command | (f * 2 - 1);
-	else
-		payload = command | (f * 2 - 2);
+	if (f < 1 || f > 5)
+		return -1;
 
-	rf->write(&payload, 1);
+	return right ? f * 2 - 1 : f * 2 - 2;
 }
 
 /**
@@ -603,24 +768,82 @@ unsigned char inverse(unsigned char finger)
 }
 
 /**
- * Keypad Handler
+ * Wait For Stop Button
  *
- * This function should be called in separate thread to wair for user action
- * while doing other operation
+ * Sleeps on the keypad subscription until the deadline, returning early
+ * when the stop button is pressed. A deadline in the past only drains the
+ * events already queued.
  * 
- * @param keypad     keypad handler
- * @param keypress   keypress handler
- * @param terminator keypad terminator
+ * @param  keys     	keypad subscription
+ * @param  deadline 	CLOCK_MONOTONIC deadline in microseconds
+ * @return          	true if the stop button was pressed
  */
-void keypadHandler(WiringPiKeypad *keypad, char *keypress, bool *terminator)
+bool waitForStop(KeySubscription *keys, long long deadline)
 {
-	while (1)
+	char key;
+
+	if (!keys)
+		return false;
+
+	while (keys->waitKey(&key, deadline))
 	{
-		*keypress = keypad->getKey(terminator);
+		if (key == STOP_BUTTON)
+			return true;
+	}
 
-		if (*keypress == STOP_BUTTON || !(*terminator))
-		{
-			break;
-		}
+	return false;
+}
+
+/**
+ * Get Evaluator Command
+ *
+ * Drains the keypad subscription without blocking. Pressing stop ends the
+ * session, holding skip moves on one chord now and one more per repeat.
+ * 
+ * @param  keys 	keypad subscription
+ * @return      	STOP_BUTTON, SKIP_BUTTON, or 0 if there is no command
+ */
+char getCommand(KeySubscription *keys)
+{
+	struct KeyEvent event;
+
+	while (keys && keys->poll(&event))
+	{
+		if (isCommand(&event))
+			return event.key;
 	}
-}
\ No newline at end of file
+
+	return 0;
+}
+
+/**
+ * Check Evaluator Command
+ * 
+ * @param  event 	key event
+ * @return       	true if the event is a stop or skip command
+ */
+bool isCommand(const struct KeyEvent *event)
+{
+	if (event->type == KEYPAD_DOWN && event->key == STOP_BUTTON)
+		return true;
+
+	if ((event->type == KEYPAD_LONG_PRESS || event->type == KEYPAD_REPEAT) && event->key == SKIP_BUTTON)
+		return true;
+
+	return false;
+}
+
+/**
+ * Interrupt On Command
+ *
+ * Key callback that wakes the evaluator from its MIDI input wait on a
+ * stop or skip command. Runs on the input thread.
+ * 
+ * @param event     key event
+ * @param io        MIDI IO handler
+ */
+void interruptOnCommand(const struct KeyEvent *event, void *io)
+{
+	if (isCommand(event))
+		((MidiIO *) io)->interrupt();
+}
@@ -0,0 +1,414 @@
+/**
+ * Evdev Keyboard Keypad Library
+ *
+ * Copyright (c) 2015 Ilham Imaduddin <ilham.imaduddin@mail.ugm.ac.id>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "EvdevKeypad.h"
+
+static const struct
+{
+	int code;
+	char symbol;
+} defaultKeymap[] = {
+	{KEY_0, '0'}, {KEY_1, '1'}, {KEY_2, '2'}, {KEY_3, '3'}, {KEY_4, '4'},
+	{KEY_5, '5'}, {KEY_6, '6'}, {KEY_7, '7'}, {KEY_8, '8'}, {KEY_9, '9'},
+	{KEY_KP0, '0'}, {KEY_KP1, '1'}, {KEY_KP2, '2'}, {KEY_KP3, '3'}, {KEY_KP4, '4'},
+	{KEY_KP5, '5'}, {KEY_KP6, '6'}, {KEY_KP7, '7'}, {KEY_KP8, '8'}, {KEY_KP9, '9'},
+	{KEY_A, 'A'}, {KEY_B, 'B'}, {KEY_C, 'C'}, {KEY_D, 'D'},
+	{KEY_KPSLASH, 'A'}, {KEY_KPASTERISK, 'B'}, {KEY_KPMINUS, 'C'}, {KEY_KPPLUS, 'D'},
+	{KEY_ESC, 'D'}, {KEY_KPDOT, '*'}, {KEY_KPENTER, '#'}
+};
+
+/**
+ * Class constructor
+ *
+ * Every keyboard found in /dev/input is used.
+ */
+EvdevKeypad::EvdevKeypad(void) : EvdevKeypad(std::string())
+{
+
+}
+
+/**
+ * Class constructor
+ * 
+ * @param path 	event device to use, empty to search /dev/input
+ */
+EvdevKeypad::EvdevKeypad(const std::string &path)
+: devicePath(path), epollFd(-1), deviceCount(0), grab(true), pressedCount(0), changeTime(0), changePending(false)
+{
+	memset(keymap, 0, sizeof(keymap));
+
+	for (unsigned int i = 0; i < sizeof(defaultKeymap) / sizeof(defaultKeymap[0]); i++)
+		keymap[defaultKeymap[i].code] = defaultKeymap[i].symbol;
+}
+
+/**
+ * Class destructor
+ */
+EvdevKeypad::~EvdevKeypad()
+{
+	while (deviceCount > 0)
+		removeDevice(deviceFd[0]);
+
+	if (epollFd >= 0)
+		close(epollFd);
+}
+
+/**
+ * Open the keyboards
+ *
+ * Opened devices are grabbed unless disabled with setGrab(), so the
+ * keypresses do not reach the console.
+ * 
+ * @return  false if no keyboard could be opened
+ */
+bool EvdevKeypad::begin(void)
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (epollFd < 0)
+		return false;
+
+	if (!devicePath.empty())
+		return addDevice(devicePath);
+
+	DIR *dir = opendir(EVDEV_DIR);
+
+	if (!dir)
+		return false;
+
+	struct dirent *entry;
+
+	while ((entry = readdir(dir)) && deviceCount < MAX_EVDEV_DEVICES)
+	{
+		if (strncmp(entry->d_name, "event", 5) == 0)
+			addDevice(std::string(EVDEV_DIR "/") + entry->d_name);
+	}
+
+	closedir(dir);
+
+	return deviceCount > 0;
+}
+
+/**
+ * Grab the devices for exclusive use
+ *
+ * Must be called before begin().
+ * 
+ * @param enable 	grab state
+ */
+void EvdevKeypad::setGrab(bool enable)
+{
+	grab = enable;
+}
+
+/**
+ * Map a key code to a keypad symbol
+ * 
+ * @param code   	evdev key code
+ * @param symbol 	keypad symbol, 0 to ignore the key
+ */
+void EvdevKeypad::mapKey(int code, char symbol)
+{
+	if (code >= 0 && code < KEY_CNT)
+		keymap[code] = symbol;
+}
+
+/**
+ * Get number of open devices
+ * 
+ * @return  device count
+ */
+int EvdevKeypad::getDeviceCount(void)
+{
+	return deviceCount;
+}
+
+/**
+ * Get key symbol
+ * 
+ * @param  k 	key position, the column holds the key code
+ * @return   	mapped symbol
+ */
+char EvdevKeypad::getSymbol(struct key k)
+{
+	return keymap[k.column];
+}
+
+/**
+ * Check whether a device has keypad keys
+ *
+ * Mice, power buttons and remotes also report key events, so a numpad
+ * key, or a digit and a letter, are required.
+ * 
+ * @param  fd 	open event device
+ * @return    	true if the device can be used as a keypad
+ */
+bool EvdevKeypad::isKeypad(int fd)
+{
+	unsigned char bits[KEY_CNT / 8 + 1];
+	memset(bits, 0, sizeof(bits));
+
+	if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(bits)), bits) < 0)
+		return false;
+
+	#define HAS_KEY(code) (bits[(code) / 8] & (1 << ((code) % 8)))
+
+	bool keypad = HAS_KEY(KEY_KP5) || (HAS_KEY(KEY_5) && HAS_KEY(KEY_A));
+
+	#undef HAS_KEY
+
+	return keypad;
+}
+
+/**
+ * Open an event device and watch it
+ * 
+ * @param  path 	event device path
+ * @return      	status
+ */
+bool EvdevKeypad::addDevice(const std::string &path)
+{
+	if (deviceCount >= MAX_EVDEV_DEVICES)
+		return false;
+
+	int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+	if (fd < 0)
+		return false;
+
+	if (!isKeypad(fd))
+	{
+		close(fd);
+		return false;
+	}
+
+	/* Stamp events on the same clock as the scheduler */
+	int clock = CLOCK_MONOTONIC;
+	if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	if (grab && ioctl(fd, EVIOCGRAB, 1) < 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	struct epoll_event watch;
+	watch.events = EPOLLIN;
+	watch.data.fd = fd;
+
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &watch) < 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	char name[256] = "Unknown";
+	ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+
+	deviceFd[deviceCount] = fd;
+	deviceName[deviceCount] = path + " (" + name + ")";
+	deviceCount++;
+
+	return true;
+}
+
+/**
+ * Stop watching a device
+ *
+ * Keys held on an unplugged keyboard are reported as released.
+ * 
+ * @param fd 	event device
+ */
+void EvdevKeypad::removeDevice(int fd)
+{
+	for (int i = 0; i < deviceCount; i++)
+	{
+		if (deviceFd[i] != fd)
+			continue;
+
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+		close(fd);
+
+		deviceCount--;
+		deviceFd[i] = deviceFd[deviceCount];
+		deviceName[i] = deviceName[deviceCount];
+
+		pressedCount = 0;
+		changeTime = timestamp();
+		changePending = true;
+
+		return;
+	}
+}
+
+/**
+ * Update the pressed keys
+ * 
+ * @param code 	evdev key code
+ * @param down 	true on press
+ * @return     	true if the pressed keys changed
+ */
+bool EvdevKeypad::press(int code, bool down)
+{
+	for (int i = 0; i < pressedCount; i++)
+	{
+		if (pressed[i].column != code)
+			continue;
+
+		if (down)
+			return false;
+
+		pressedCount--;
+		for (int j = i; j < pressedCount; j++)
+			pressed[j] = pressed[j + 1];
+
+		return true;
+	}
+
+	if (!down || pressedCount >= MAX_HELD_KEYS)
+		return false;
+
+	pressed[pressedCount].row = 0;
+	pressed[pressedCount].column = code;
+	pressedCount++;
+
+	return true;
+}
+
+/**
+ * Read events until a mapped key changes
+ *
+ * Events are read one at a time, so a press and release that arrive
+ * together are still reported as two changes.
+ * 
+ * @param  fd 	event device
+ * @return    	true if a key changed
+ */
+bool EvdevKeypad::readChange(int fd)
+{
+	struct input_event ev;
+
+	while (1)
+	{
+		ssize_t n = read(fd, &ev, sizeof(ev));
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n < 0 && errno == EAGAIN)
+			return false;
+
+		if (n != sizeof(ev))
+		{
+			removeDevice(fd);
+			return changePending;
+		}
+
+		/* Kernel auto-repeat is ignored, repeats come from the gestures */
+		if (ev.type != EV_KEY || ev.code >= KEY_CNT || !keymap[ev.code] || ev.value == 2)
+			continue;
+
+		if (!press(ev.code, ev.value == 1))
+			continue;
+
+#ifdef input_event_sec
+		changeTime = ev.input_event_sec * 1000000LL + ev.input_event_usec;
+#else
+		changeTime = ev.time.tv_sec * 1000000LL + ev.time.tv_usec;
+#endif
+		changePending = true;
+
+		return true;
+	}
+}
+
+/**
+ * Wait for a key event
+ *
+ * Blocks in epoll until a keyboard reports a key or a long press or
+ * repeat deadline passes. Event times are the kernel's timestamps.
+ * 
+ * @param  event 		event container
+ * @param  terminator 	keep waiting while true
+ * @return            	false if the terminator stopped the wait
+ */
+bool EvdevKeypad::getEvent(struct KeyEvent *event, const std::atomic<bool> *terminator)
+{
+	struct epoll_event ready[MAX_EVDEV_DEVICES];
+
+	while (*terminator)
+	{
+		if (changePending)
+		{
+			changePending = false;
+
+			if (updateKeys(pressed, pressedCount, changeTime, event))
+			{
+				/* One change can still hold another event, look again */
+				changePending = true;
+
+				return true;
+			}
+		}
+
+		if (checkGesture(event))
+			return true;
+
+		int timeout = EVDEV_POLL_TIMEOUT;
+		int gesture = getGestureTimeout();
+		timeout = gesture >= 0 && gesture < timeout ? gesture : timeout;
+
+		int count = epoll_wait(epollFd, ready, MAX_EVDEV_DEVICES, timeout);
+
+		for (int i = 0; i < count; i++)
+		{
+			if (readChange(ready[i].data.fd))
+				break;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Print setup details
+ */
+void EvdevKeypad::printDetails(void)
+{
+	std::cout << "Devices:\t" << deviceCount << std::endl;
+
+	for (int i = 0; i < deviceCount; i++)
+	{
+		std::cout << "\t\t" << deviceName[i] << std::endl;
+	}
+
+	std::cout << "Grab:\t\t" << (grab ? "enabled" : "disabled") << std::endl;
+	std::cout << "Long press:\t" << longPressDelay << std::endl;
+	std::cout << "Repeat:\t\t" << repeatInterval << std::endl;
+}
@@ -0,0 +1,279 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "GpioLines.h"
+
+/**
+ * GpioLines Class Constructor
+ */
+GpioLines::GpioLines() : fd(-1), count(0)
+{
+
+}
+
+/**
+ * GpioLines Class Destructor
+ */
+GpioLines::~GpioLines()
+{
+	release();
+}
+
+/**
+ * Request lines
+ *
+ * @param  chip    	GPIO chip device
+ * @param  offsets 	line offsets on the chip
+ * @param  n       	number of lines
+ * @param  flags   	GPIO_V2_LINE_FLAG_* flags
+ * @param  values  	initial output values, bit n for line n
+ * @return         	status
+ */
+bool GpioLines::request(const char *chip, const int *offsets, int n, unsigned long long flags, unsigned long long values)
+{
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	if (n < 1 || n > MAX_GPIO_LINES)
+		return false;
+
+	release();
+
+	int chipFd = open(chip, O_RDONLY | O_CLOEXEC);
+
+	if (chipFd < 0)
+		return false;
+
+	struct gpio_v2_line_request req;
+	memset(&req, 0, sizeof(req));
+
+	for (int i = 0; i < n; i++)
+		req.offsets[i] = offsets[i];
+
+	strncpy(req.consumer, GPIO_CONSUMER, sizeof(req.consumer) - 1);
+	req.num_lines = n;
+	req.config.flags = flags;
+
+	if (flags & GPIO_V2_LINE_FLAG_OUTPUT)
+	{
+		req.config.num_attrs = 1;
+		req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+		req.config.attrs[0].attr.values = values;
+		req.config.attrs[0].mask = (1ULL << n) - 1;
+	}
+
+	int status = ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &req);
+	close(chipFd);
+
+	if (status < 0 || req.fd <= 0)
+		return false;
+
+	fd = req.fd;
+	count = n;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Request input lines
+ *
+ * @param  chip    	GPIO chip device
+ * @param  offsets 	line offsets on the chip
+ * @param  n       	number of lines
+ * @param  pullUp  	enable the pull-up bias
+ * @param  edges   	report both edges
+ * @return         	status
+ */
+bool GpioLines::requestInput(const char *chip, const int *offsets, int n, bool pullUp, bool edges)
+{
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	unsigned long long flags = GPIO_V2_LINE_FLAG_INPUT;
+
+	if (pullUp)
+		flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+
+	if (edges)
+		flags |= GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+
+	return request(chip, offsets, n, flags, 0);
+#else
+	return false;
+#endif
+}
+
+/**
+ * Request output lines
+ *
+ * @param  chip      	GPIO chip device
+ * @param  offsets   	line offsets on the chip
+ * @param  n         	number of lines
+ * @param  openDrain 	only drive the lines low, a high line floats
+ * @param  values    	initial values, bit n for line n
+ * @return           	status
+ */
+bool GpioLines::requestOutput(const char *chip, const int *offsets, int n, bool openDrain, unsigned long long values)
+{
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	unsigned long long flags = GPIO_V2_LINE_FLAG_OUTPUT;
+
+	if (openDrain)
+		flags |= GPIO_V2_LINE_FLAG_OPEN_DRAIN;
+
+	return request(chip, offsets, n, flags, values);
+#else
+	return false;
+#endif
+}
+
+/**
+ * Release the lines
+ */
+void GpioLines::release(void)
+{
+	if (fd >= 0)
+		close(fd);
+
+	fd = -1;
+	count = 0;
+}
+
+/**
+ * Check whether lines are requested
+ *
+ * @return  true if requested
+ */
+bool GpioLines::isOpen(void)
+{
+	return fd >= 0;
+}
+
+/**
+ * Read all lines
+ *
+ * @param  values 	values container, bit n for line n
+ * @return        	status
+ */
+bool GpioLines::getValues(unsigned long long *values)
+{
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	struct gpio_v2_line_values data;
+	data.bits = 0;
+	data.mask = (1ULL << count) - 1;
+
+	if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &data) < 0)
+		return false;
+
+	*values = data.bits;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Write lines
+ *
+ * @param  values 	values, bit n for line n
+ * @param  mask   	lines to write, bit n for line n
+ * @return        	status
+ */
+bool GpioLines::setValues(unsigned long long values, unsigned long long mask)
+{
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	struct gpio_v2_line_values data;
+	data.bits = values;
+	data.mask = mask & ((1ULL << count) - 1);
+
+	return ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &data) == 0;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Wait for edges
+ *
+ * Every queued edge is consumed.
+ *
+ * @param  timeout 	timeout in milliseconds, negative to wait forever
+ * @param  time    	CLOCK_MONOTONIC time of the last edge in microseconds
+ * @return         	number of edges, 0 on timeout, -1 on error
+ */
+int GpioLines::waitEdges(int timeout, long long *time)
+{
+#ifdef GPIO_V2_GET_LINE_IOCTL
+	struct pollfd watch;
+	watch.fd = fd;
+	watch.events = POLLIN;
+	watch.revents = 0;
+
+	int ready = poll(&watch, 1, timeout);
+
+	if (ready <= 0)
+		return ready < 0 && errno != EINTR ? -1 : 0;
+
+	struct gpio_v2_line_event events[GPIO_EVENT_BATCH];
+	int edges = 0;
+
+	while (1)
+	{
+		ssize_t n = read(fd, events, sizeof(events));
+
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		if (n < (ssize_t) sizeof(events[0]))
+			break;
+
+		int batch = n / sizeof(events[0]);
+		edges += batch;
+
+		/* Line events are stamped on CLOCK_MONOTONIC by default */
+		if (time)
+			*time = events[batch - 1].timestamp_ns / 1000;
+
+		if (batch < GPIO_EVENT_BATCH)
+			break;
+
+		/* More may be queued, only read on without blocking */
+		if (poll(&watch, 1, 0) <= 0)
+			break;
+	}
+
+	return edges;
+#else
+	return -1;
+#endif
+}
@@ -0,0 +1,295 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "InputService.h"
+
+/**
+ * KeySubscription Class Constructor
+ */
+KeySubscription::KeySubscription() : active(false), callback(NULL), userData(NULL), dropped(0), serviceRunning(NULL)
+{
+
+}
+
+/**
+ * Queue event and wake the consumer
+ *
+ * @param event 	key event
+ */
+void KeySubscription::publish(const struct KeyEvent *event)
+{
+	if (!queue.push(*event))
+	{
+		dropped++;
+		return;
+	}
+
+	if (callback)
+		callback(event, userData);
+
+	/* Taking the lock keeps the notify from slipping between the
+	 * consumer's empty check and its sleep */
+	std::lock_guard<std::mutex> lock(waitMutex);
+	ready.notify_one();
+}
+
+/**
+ * Wake the consumer without an event
+ */
+void KeySubscription::wake(void)
+{
+	std::lock_guard<std::mutex> lock(waitMutex);
+	ready.notify_all();
+}
+
+/**
+ * Take the next event without blocking
+ *
+ * @param  event 	event container
+ * @return       	false if no event is queued
+ */
+bool KeySubscription::poll(struct KeyEvent *event)
+{
+	return queue.pop(event);
+}
+
+/**
+ * Wait for the next event
+ *
+ * @param  event    	event container
+ * @param  deadline 	CLOCK_MONOTONIC deadline in microseconds, negative to wait forever
+ * @return          	false if the deadline passed or the service stopped first
+ */
+bool KeySubscription::wait(struct KeyEvent *event, long long deadline)
+{
+	std::unique_lock<std::mutex> lock(waitMutex);
+	auto woken = [this] { return !queue.empty() || !*serviceRunning; };
+
+	if (deadline < 0)
+	{
+		ready.wait(lock, woken);
+	}
+	else
+	{
+		/* steady_clock is CLOCK_MONOTONIC on Linux */
+		long long remaining = deadline - InputService::timestamp();
+
+		if (remaining > 0)
+			ready.wait_for(lock, std::chrono::microseconds(remaining), woken);
+	}
+
+	if (!*serviceRunning)
+		return false;
+
+	return queue.pop(event);
+}
+
+/**
+ * Wait for a key press
+ *
+ * @param  key      	key container
+ * @param  deadline 	CLOCK_MONOTONIC deadline in microseconds, negative to wait forever
+ * @return          	false if the deadline passed or the service stopped first
+ */
+bool KeySubscription::waitKey(char *key, long long deadline)
+{
+	struct KeyEvent event;
+
+	while (wait(&event, deadline))
+	{
+		if (event.type == KEYPAD_DOWN)
+		{
+			*key = event.key;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Get dropped event count
+ *
+ * @return  events lost on a full queue
+ */
+unsigned long KeySubscription::getDroppedCount(void)
+{
+	return dropped;
+}
+
+/**
+ * InputService Class Constructor
+ *
+ * @param _keypad 	initialized keypad
+ */
+InputService::InputService(Keypad *_keypad) : keypad(_keypad), running(false)
+{
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+		subscriptions[i].serviceRunning = &running;
+}
+
+/**
+ * InputService Class Destructor
+ */
+InputService::~InputService()
+{
+	stop();
+}
+
+/**
+ * Start input thread
+ */
+void InputService::start(void)
+{
+	if (running)
+		return;
+
+	running = true;
+	worker = std::thread(&InputService::run, this);
+}
+
+/**
+ * Stop input thread
+ *
+ * Consumers waiting on a subscription are woken up.
+ */
+void InputService::stop(void)
+{
+	if (!running)
+		return;
+
+	running = false;
+
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+		subscriptions[i].wake();
+
+	worker.join();
+}
+
+/**
+ * Input thread routine
+ */
+void InputService::run(void)
+{
+	struct KeyEvent event;
+
+	while (keypad->getEvent(&event, &running))
+	{
+		/* Held so a callback never outlives its unsubscribe */
+		std::lock_guard<std::mutex> lock(subscribeMutex);
+
+		for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+		{
+			if (subscriptions[i].active.load(std::memory_order_acquire))
+				subscriptions[i].publish(&event);
+		}
+	}
+}
+
+/**
+ * Subscribe to key events
+ *
+ * Only events that happen after this call are delivered.
+ *
+ * @param  callback 	optional wake callback, run on the input thread
+ * @param  userData 	callback argument
+ * @return          	subscription, or null if every slot is taken
+ */
+KeySubscription *InputService::subscribe(KeyCallback callback, void *userData)
+{
+	std::lock_guard<std::mutex> lock(subscribeMutex);
+
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+	{
+		KeySubscription *s = &subscriptions[i];
+
+		if (s->active)
+			continue;
+
+		/* Drop events left over from the previous owner */
+		struct KeyEvent stale;
+		while (s->queue.pop(&stale));
+
+		s->callback = callback;
+		s->userData = userData;
+		s->dropped = 0;
+		s->active.store(true, std::memory_order_release);
+
+		return s;
+	}
+
+	return NULL;
+}
+
+/**
+ * Release subscription
+ *
+ * @param subscription 	subscription to release
+ */
+void InputService::unsubscribe(KeySubscription *subscription)
+{
+	if (!subscription)
+		return;
+
+	std::lock_guard<std::mutex> lock(subscribeMutex);
+	subscription->active.store(false, std::memory_order_release);
+}
+
+/**
+ * Wait for the next key press
+ *
+ * @return  pressed key, 0 if the service stopped
+ */
+char InputService::getKey(void)
+{
+	char key = 0;
+	KeySubscription *s = subscribe();
+
+	if (!s)
+		return 0;
+
+	s->waitKey(&key, -1);
+	unsubscribe(s);
+
+	return key;
+}
+
+/**
+ * Get monotonic timestamp
+ *
+ * @return  CLOCK_MONOTONIC time in microseconds
+ */
+long long InputService::timestamp(void)
+{
+	return Keypad::timestamp();
+}
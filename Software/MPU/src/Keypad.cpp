@@ -0,0 +1,244 @@
+/**
+ * Keypad Input Interface
+ *
+ * Copyright (c) 2015 Ilham Imaduddin <ilham.imaduddin@mail.ugm.ac.id>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "Keypad.h"
+
+/**
+ * Class destructor
+ */
+Keypad::~Keypad()
+{
+
+}
+
+/**
+ * Get monotonic milliseconds
+ *
+ * Gesture timing only needs differences, so the value may wrap.
+ * 
+ * @return  time in milliseconds
+ */
+unsigned int Keypad::getMillis(void)
+{
+	return (unsigned int) (timestamp() / 1000);
+}
+
+/**
+ * Get monotonic timestamp
+ *
+ * @return  time in microseconds
+ */
+long long Keypad::timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * Fill a key event
+ *
+ * @param event 	event container
+ * @param k     	key position
+ * @param type  	event type
+ * @param time  	event time in microseconds
+ */
+void Keypad::setEvent(struct KeyEvent *event, struct key k, KeyEventType type, long long time)
+{
+	event->key = getSymbol(k);
+	event->position = k;
+	event->type = type;
+	event->with = 0;
+	event->duration = 0;
+	event->time = time;
+}
+
+/**
+ * Compare key positions
+ * 
+ * @param  a 	first key
+ * @param  b 	second key
+ * @return   	true if both are the same key
+ */
+bool Keypad::isSameKey(struct key a, struct key b)
+{
+	return a.row == b.row && a.column == b.column;
+}
+
+/**
+ * Compare a scan with the held keys
+ *
+ * Reports at most one change per call, releases first. The first key down
+ * is the held key, a second key pressed while it is down makes a chord.
+ *
+ * @param  keys  	pressed keys
+ * @param  count 	number of pressed keys
+ * @param  time  	event time in microseconds
+ * @param  event 	event container
+ * @return       	true if an event was reported
+ */
+bool Keypad::updateKeys(struct key *keys, int count, long long time, struct KeyEvent *event)
+{
+	bool heldDown = false;
+	bool chordedDown = false;
+	struct key other = {-1, -1};
+
+	for (int i = 0; i < count; i++)
+	{
+		if (isSameKey(keys[i], held))
+			heldDown = true;
+		else if (isSameKey(keys[i], chorded))
+			chordedDown = true;
+		else
+			other = keys[i];
+	}
+
+	if (chorded.row >= 0 && !chordedDown)
+	{
+		setEvent(event, chorded, KEYPAD_UP, time);
+		event->duration = getMillis() - chordedAt;
+		chorded.row = -1;
+		chorded.column = -1;
+
+		return true;
+	}
+
+	if (held.row >= 0 && !heldDown)
+	{
+		setEvent(event, held, KEYPAD_UP, time);
+		event->duration = getMillis() - pressedAt;
+
+		/* The chord partner stays down but never turns into a long press */
+		held = chorded;
+		pressedAt = chordedAt;
+		chorded.row = -1;
+		chorded.column = -1;
+
+		return true;
+	}
+
+	if (held.row < 0 && other.row >= 0)
+	{
+		held = other;
+		pressedAt = getMillis();
+		nextGesture = pressedAt + longPressDelay;
+		longPressed = false;
+		chordSeen = false;
+		setEvent(event, held, KEYPAD_DOWN, time);
+
+		return true;
+	}
+
+	if (chorded.row < 0 && other.row >= 0)
+	{
+		chorded = other;
+		chordedAt = getMillis();
+		chordSeen = true;
+		setEvent(event, chorded, KEYPAD_CHORD, time);
+		event->with = getSymbol(held);
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Get time until the next long press or repeat
+ *
+ * @return  timeout in milliseconds, negative if nothing is due
+ */
+int Keypad::getGestureTimeout(void)
+{
+	if (held.row < 0 || chordSeen || longPressDelay <= 0 || (longPressed && repeatInterval <= 0))
+		return -1;
+
+	int timeout = (int) (nextGesture - getMillis());
+
+	return timeout > 0 ? timeout : 0;
+}
+
+/**
+ * Report a long press or repeat that is due
+ *
+ * @param  event 	event container
+ * @return       	true if an event was reported
+ */
+bool Keypad::checkGesture(struct KeyEvent *event)
+{
+	if (getGestureTimeout() != 0)
+		return false;
+
+	setEvent(event, held, longPressed ? KEYPAD_REPEAT : KEYPAD_LONG_PRESS, timestamp());
+	event->duration = getMillis() - pressedAt;
+
+	longPressed = true;
+	nextGesture += repeatInterval;
+
+	return true;
+}
+
+/**
+ * Set long press delay
+ *
+ * Repeats start after a long press, a delay of 0 disables both.
+ * 
+ * @param delay 	delay in miliseconds
+ */
+void Keypad::setLongPressDelay(int delay)
+{
+	longPressDelay = delay;
+}
+
+/**
+ * Set repeat interval
+ * 
+ * @param interval 	interval in miliseconds, 0 to disable repeats
+ */
+void Keypad::setRepeatInterval(int interval)
+{
+	repeatInterval = interval;
+}
+
+/**
+ * Get long press delay
+ * 
+ * @return  delay in miliseconds
+ */
+int Keypad::getLongPressDelay(void)
+{
+	return longPressDelay;
+}
+
+/**
+ * Get repeat interval
+ * 
+ * @return  interval in miliseconds
+ */
+int Keypad::getRepeatInterval(void)
+{
+	return repeatInterval;
+}
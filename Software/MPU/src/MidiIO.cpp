@@ -38,7 +38,7 @@
 *
 * This constructor set the default input and output port to 1
 */
-MidiIO::MidiIO(): inPort(1), outPort(1)
+MidiIO::MidiIO(): inPort(1), outPort(1), debug(false), queueEnabled(false), interrupted(false)
 {
 	initIO();
 }
@@ -55,7 +55,7 @@ MidiIO::MidiIO(): inPort(1), outPort(1)
  * @param  int 	in 	input port
  * @param  int 	out	output port
  */
-MidiIO::MidiIO(int in, int out): inPort(in - 1), outPort(out - 1)
+MidiIO::MidiIO(int in, int out): inPort(in - 1), outPort(out - 1), debug(false), queueEnabled(false), interrupted(false)
 {
 	initIO();
 }
@@ -72,7 +72,7 @@ void MidiIO::initIO(void)
 
 	try
 	{
-		in = new RtMidiIn();
+		in = new RtMidiIn(RtMidi::UNSPECIFIED, "RtMidi Input Client", DEFAULT_INPUT_QUEUE_SIZE);
 		out = new RtMidiOut();
 	}
 	catch (RtMidiError &error)
@@ -86,6 +86,8 @@ void MidiIO::initIO(void)
 
 	if (debug && out)
 		std::cout << "MIDI In instance created." << std::endl;
+
+	in->setQueueNotifier(&MidiIO::inputNotifier, this);
 }
 
 /**
@@ -100,6 +102,60 @@ void MidiIO::enableDebug(bool enable)
 	debug = enable;
 }
 
+/**
+ * Enable Scheduled Output
+ *
+ * This option will let the sequencer queue time the playback
+ *
+ * @param 	bool 	enable
+ */
+void MidiIO::enableQueue(bool enable)
+{
+	queueEnabled = enable;
+}
+
+/**
+ * Check Scheduled Output
+ * 
+ * @return  true if scheduled output is enabled
+ */
+bool MidiIO::isQueueEnabled(void)
+{
+	return queueEnabled;
+}
+
+/**
+ * Set Input Queue Size
+ *
+ * Only takes effect while the input port is closed
+ * 
+ * @param size 	maximum number of pending messages
+ */
+void MidiIO::setInputQueueSize(unsigned int size)
+{
+	in->setQueueSizeLimit(size);
+}
+
+/**
+ * Get Input Queue Overflow Count
+ * 
+ * @return  number of messages dropped because the input queue was full
+ */
+unsigned long MidiIO::getInputOverflowCount(void)
+{
+	return in->getQueueOverflowCount();
+}
+
+/**
+ * Get SysEx Overflow Count
+ * 
+ * @return  number of SysEx messages dropped because the side queue was full
+ */
+unsigned long MidiIO::getSysexOverflowCount(void)
+{
+	return in->getSysexOverflowCount();
+}
+
 /**
  * Open MIDI Input Port
  * 
@@ -206,6 +262,132 @@ void MidiIO::sendMessage(std::vector<unsigned char> *message)
 	out->sendMessage(message);
 }
 
+/**
+ * Send Raw MIDI Message to Output Port
+ * 
+ * @param message 	message bytes
+ * @param size 		message size
+ */
+void MidiIO::sendMessage(const unsigned char *message, size_t size)
+{
+	out->sendMessage(message, size);
+}
+
+/**
+ * Send Several MIDI Messages to Output Port
+ *
+ * Messages are stored back to back and flushed to the device at once.
+ * 
+ * @param messages 	concatenated message bytes
+ * @param sizes 	size of each message
+ * @param count 	number of messages
+ */
+void MidiIO::sendMessages(const unsigned char *messages, const size_t *sizes, size_t count)
+{
+	out->sendMessages(messages, sizes, count);
+}
+
+/**
+ * Start Output Queue
+ *
+ * The queue time starts at zero and counts song microseconds,
+ * stretched by the tempo scale
+ * 
+ * @param  tempoScale 	real time per song time
+ * @return            	status
+ */
+int MidiIO::startQueue(double tempoScale)
+{
+	if (debug)
+		std::cout << "  Starting output queue...\n";
+
+	if (!out->startQueue(tempoScale))
+	{
+		if (debug)
+			std::cout << "  Output queue is not available.\n";
+
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Set Output Queue Tempo
+ *
+ * Scheduled events keep their timestamps, only the queue speed changes
+ * 
+ * @param tempoScale 	real time per song time
+ */
+void MidiIO::setQueueTempo(double tempoScale)
+{
+	out->setQueueTempo(tempoScale);
+}
+
+/**
+ * Schedule MIDI Messages
+ *
+ * Queue ticks are 32 bit microseconds, so times past about 71 minutes
+ * are clamped to the last tick
+ * 
+ * @param messages 	concatenated message bytes
+ * @param sizes 	size of each message
+ * @param count 	number of messages
+ * @param time 		song time in microseconds
+ */
+void MidiIO::scheduleMessages(const unsigned char *messages, const size_t *sizes, size_t count, long long time)
+{
+	if (time < 0)
+		time = 0;
+	else if (time > UINT_MAX)
+		time = UINT_MAX;
+
+	out->scheduleMessages(messages, sizes, count, (unsigned int) time);
+}
+
+/**
+ * Get Output Queue Time
+ * 
+ * @return  song time in microseconds
+ */
+long long MidiIO::getQueueTime(void)
+{
+	return out->getQueueTime();
+}
+
+/**
+ * Wait for Output Queue
+ *
+ * Blocks until every scheduled message has been sent
+ */
+void MidiIO::syncQueue(void)
+{
+	out->syncQueue();
+}
+
+/**
+ * Stop Output Queue
+ *
+ * Pending events are discarded and every channel is silenced
+ */
+void MidiIO::stopQueue(void)
+{
+	unsigned char allNotesOff[16 * 3];
+	size_t sizes[16];
+
+	out->stopQueue();
+
+	for (int channel = 0; channel < 16; channel++)
+	{
+		allNotesOff[channel * 3] = 0xB0 | channel;
+		allNotesOff[channel * 3 + 1] = 123;
+		allNotesOff[channel * 3 + 2] = 0;
+		sizes[channel] = 3;
+	}
+
+	out->sendMessages(allNotesOff, sizes, 16);
+}
+
 /**
  * Receive MIDI message from Input port
  * 
@@ -215,4 +397,66 @@ void MidiIO::sendMessage(std::vector<unsigned char> *message)
 double MidiIO::getMessage(std::vector<unsigned char> *message)
 {
 	return in->getMessage(message);
-}
\ No newline at end of file
+}
+
+/**
+ * Wait for MIDI message from Input port
+ *
+ * Blocks until a message arrives, interrupt() is called, or the timeout
+ * expires. The container is left empty if no message was received.
+ * 
+ * @param  message 	message container
+ * @param  timeout 	timeout in milliseconds, negative to wait forever
+ * @return         	stamp
+ */
+double MidiIO::waitMessage(std::vector<unsigned char> *message, int timeout)
+{
+	{
+		std::unique_lock<std::mutex> lock(inputMutex);
+		auto ready = [this] { return in->getQueueCount() > 0 || interrupted; };
+
+		if (timeout < 0)
+			inputReady.wait(lock, ready);
+		else
+			inputReady.wait_for(lock, std::chrono::milliseconds(timeout), ready);
+
+		interrupted = false;
+	}
+
+	return getMessage(message);
+}
+
+/**
+ * Interrupt Input Wait
+ *
+ * Wakes up the thread blocked in waitMessage(). If no thread is waiting,
+ * the next call to waitMessage() returns immediately.
+ */
+void MidiIO::interrupt(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(inputMutex);
+		interrupted = true;
+	}
+
+	inputReady.notify_one();
+}
+
+/**
+ * Input Notifier
+ *
+ * Called by the RtMidi input thread after every queued message
+ *
+ * @param userData 	MidiIO instance
+ */
+void MidiIO::inputNotifier(void *userData)
+{
+	MidiIO *io = (MidiIO *) userData;
+
+	// Taking the lock orders the push before a waiter's predicate check
+	{
+		std::lock_guard<std::mutex> lock(io->inputMutex);
+	}
+
+	io->inputReady.notify_one();
+}
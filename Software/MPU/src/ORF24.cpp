@@ -24,6 +24,8 @@
 
 #include "ORF24.h"
 
+ORF24 *ORF24::irqInstance = NULL;
+
 ORF24::ORF24(int _ce)
 	: ce(_ce),
 	  csn(10),
@@ -52,12 +54,16 @@ bool ORF24::begin(void)
 		std::cout << "Setting up SPI Communication Controller...\n";
 	}
 
+	/* The chip keeps its registers across our restarts */
+	invalidateCache();
+
 	/* Settipng up CE pin */
 	pinMode(ce, OUTPUT);
 	digitalWrite(ce, LOW);
 
 	/* Initializing SPI communication */
 	wiringPiSPISetup(spiChannel, spiSpeed);
+	spiFd = wiringPiSPIGetFd(spiChannel);
 
 	/* Pulldown MOSI and SCK pin */
 	pullUpDnControl(MOSI_PIN, PUD_DOWN);
@@ -81,6 +87,10 @@ bool ORF24::begin(void)
 	setDataRate(RF_DR_1MBPS);
 	setCRCLength(CRC_1_BYTE);
 	writeRegister(DYNPD, 0);
+	writeRegister(FEATURE, 0);
+	dynamicPayloadAvailable = false;
+	dynamicAckEnabled = false;
+	ackPayloadEnabled = false;
 	writeRegister(STATUS, (1 < RX_DR) | (1 << TX_DS) | (1 << MAX_RT));
 	setChannel(0);
 
@@ -103,12 +113,27 @@ bool ORF24::begin(void)
  */
 unsigned char ORF24::readRegister(unsigned char reg)
 {
+	bool cacheable = isCacheable(reg);
+
+	if (cacheable && (shadowValid & (1 << reg)))
+	{
+		cacheHits++;
+		return shadow[reg];
+	}
+
 	unsigned char *p = buffer;
 
 	*p++ = (R_REGISTER | (RW_MASK & reg)); 		/* Set SPI command to read register */
 	*p = NOP;									/* Set dummy data */
 
-	wiringPiSPIDataRW(spiChannel, buffer, 2); 		/* Start read register */
+	transfer(buffer, 2, true); 					/* Start read register */
+
+	if (cacheable)
+	{
+		cacheMisses++;
+		shadow[reg] = *p;
+		shadowValid |= (1 << reg);
+	}
 
 	return *p;									/* Read register value */
 }
@@ -123,6 +148,15 @@ unsigned char ORF24::readRegister(unsigned char reg)
  */
 unsigned char ORF24::readRegister(unsigned char reg, unsigned char *buf, int len)
 {
+	int slot = getAddressSlot(reg);
+
+	if (slot >= 0 && len == ADDRESS_SIZE && addressValid[slot])
+	{
+		cacheHits++;
+		memcpy(buf, addressShadow[slot], ADDRESS_SIZE);
+		return lastStatus;
+	}
+
 	unsigned char *p = buffer;
 
 	*p++ = (R_REGISTER | (RW_MASK & reg));
@@ -132,7 +166,14 @@ unsigned char ORF24::readRegister(unsigned char reg, unsigned char *buf, int len
 		*p++ = NOP;
 	}
 
-	wiringPiSPIDataRW(spiChannel, buffer, len + 1);
+	transfer(buffer, len + 1, true);
+
+	if (slot >= 0 && len == ADDRESS_SIZE)
+	{
+		cacheMisses++;
+		memcpy(addressShadow[slot], buffer + 1, ADDRESS_SIZE);
+		addressValid[slot] = true;
+	}
 
 	p = buffer + 1;
 	for (int i = 0; i < len; i++)
@@ -152,14 +193,27 @@ unsigned char ORF24::readRegister(unsigned char reg, unsigned char *buf, int len
  */
 unsigned char ORF24::writeRegister(unsigned char reg, unsigned char value)
 {
+	bool cacheable = isCacheable(reg);
+
+	if (cacheable && (shadowValid & (1 << reg)) && shadow[reg] == value)
+	{
+		cacheHits++;
+		return lastStatus;
+	}
+
 	unsigned char *p = buffer;
 
 	*p++ = (W_REGISTER | (RW_MASK & reg));		/* Set SPI command to write register */
 	*p = value;									/* Set data to write */
 
-	wiringPiSPIDataRW(spiChannel, buffer, 2);		/* Start write register */
+	if (cacheable)
+	{
+		cacheMisses++;
+		shadow[reg] = value;
+		shadowValid |= (1 << reg);
+	}
 
-	return *buffer;								/* Status is the first byte of receive buffer */
+	return transfer(buffer, 2, false);			/* Start write register */
 }
 
 /**
@@ -172,6 +226,21 @@ unsigned char ORF24::writeRegister(unsigned char reg, unsigned char value)
  */
 unsigned char ORF24::writeRegister(unsigned char reg, const unsigned char *buf, int len)
 {
+	int slot = getAddressSlot(reg);
+
+	if (slot >= 0 && len == ADDRESS_SIZE)
+	{
+		if (addressValid[slot] && !memcmp(addressShadow[slot], buf, ADDRESS_SIZE))
+		{
+			cacheHits++;
+			return lastStatus;
+		}
+
+		cacheMisses++;
+		memcpy(addressShadow[slot], buf, ADDRESS_SIZE);
+		addressValid[slot] = true;
+	}
+
 	unsigned char *p = buffer;
 
 	*p++ = (W_REGISTER | (RW_MASK & reg));
@@ -181,371 +250,1275 @@ unsigned char ORF24::writeRegister(unsigned char reg, const unsigned char *buf,
 		*p++ = *buf++;
 	}
 
-	wiringPiSPIDataRW(spiChannel, buffer, len + 1);
-
-	return *buffer;
+	return transfer(buffer, len + 1, false);
 }
+
 /**
- * Write payload to send
+ * Check whether a register can live in the shadow
+ *
+ * Status and measurement registers are changed by the chip itself.
  * 
- * @param  data 	data to send
- * @param  len  	data length in byte
- * @return      	nRF24L01 status
+ * @param  reg 	register address
+ * @return     	true if cacheable
  */
-unsigned char ORF24::writePayload(unsigned char *data, int len)
+bool ORF24::isCacheable(unsigned char reg)
 {
-	unsigned char *p = buffer;
-
-	*p++ = W_TX_PAYLOAD;
-	
-	for (int i = 0; i < len; i++)
+	switch (reg)
 	{
-		*p++ = *data++;
+		case STATUS:
+		case OBSERVE_TX:
+		case CD:
+		case FIFO_STATUS:
+			return false;
 	}
 
-	wiringPiSPIDataRW(spiChannel, buffer, len + 1);
-
-	return *buffer;
+	return reg < SHADOW_SIZE;
 }
 
 /**
- * Set delay and number of retry for retransmission
- *
- * @param delay 	retransmission delay
- * @param count 	retransmission count
+ * Get address shadow slot of a register
+ * 
+ * @param  reg 	register address
+ * @return     	slot number, -1 if the register has no address shadow
  */
-void ORF24::setRetries(int delay, int count)
+int ORF24::getAddressSlot(unsigned char reg)
 {
-	if (debug)
+	switch (reg)
 	{
-		std::cout << "Setting up retransmission configuration...\n";
+		case RX_ADDR_P0:	return 0;
+		case RX_ADDR_P1:	return 1;
+		case TX_ADDR:		return 2;
 	}
 
-	writeRegister(SETUP_RETR, (delay & 0xF) << ARD | (count & 0xF) << ARC);
+	return -1;
 }
 
 /**
- * Set RF channel
+ * Run one SPI command
+ *
+ * Inside a transaction, commands whose reply is not needed are queued.
+ * Commands that need the reply submit the queue first to keep the order.
  * 
- * @param channel 	channel number
+ * @param  data 	command bytes, replaced by the reply when run at once
+ * @param  len  	command length in byte
+ * @param  reply 	whether the caller reads the reply
+ * @return      	nRF24L01 status, the last known one when queued
  */
-void ORF24::setChannel(int channel)
+unsigned char ORF24::transfer(unsigned char *data, int len, bool reply)
 {
-	if (debug)
+	if (inTransaction && !reply)
 	{
-		std::cout << "Setting up RF channel...\n";
+		if (transferCount == SPI_MAX_TRANSFERS || transactionSize + len > SPI_TRANSACTION_SIZE)
+			submitTransaction();
+
+		struct spi_ioc_transfer *t = &transfers[transferCount++];
+
+		memcpy(txData + transactionSize, data, len);
+		memset(t, 0, sizeof(*t));
+		t->tx_buf = (unsigned long) (txData + transactionSize);
+		t->rx_buf = (unsigned long) (rxData + transactionSize);
+		t->len = len;
+		t->speed_hz = spiSpeed;
+		t->bits_per_word = 8;
+		t->cs_change = 1;			/* Every command is framed by CSN */
+
+		transactionSize += len;
+		spiTransfers++;
+
+		return lastStatus;
 	}
 
-	const int max = 127;
+	if (transferCount)
+		submitTransaction();
 
-	writeRegister(RF_CH, max > channel ? channel : max);
+	wiringPiSPIDataRW(spiChannel, data, len);
+	spiTransfers++;
+	spiCalls++;
+	lastStatus = *data;
+
+	return *data;
 }
 
 /**
- * Set payload size
+ * Submit queued SPI commands in one system call
  * 
- * @param size 	payload size
+ * @return  status clocked out by the first queued command
  */
-void ORF24::setPayloadSize(int size)
+unsigned char ORF24::submitTransaction(void)
 {
-	if (debug)
+	if (!transferCount)
+		return lastStatus;
+
+	/* CSN is released by the end of the message itself */
+	transfers[transferCount - 1].cs_change = 0;
+
+	if (spiFd >= 0 && ioctl(spiFd, SPI_IOC_MESSAGE(transferCount), transfers) >= 0)
 	{
-		std::cout << "Setting up payload size to " << size << "...\n";
+		spiCalls++;
 	}
+	else
+	{
+		/* No spidev access, send the commands one by one */
+		for (int i = 0; i < transferCount; i++)
+		{
+			unsigned char *tx = (unsigned char *) transfers[i].tx_buf;
+			unsigned char *rx = (unsigned char *) transfers[i].rx_buf;
 
-	const int max = 32;
+			memcpy(rx, tx, transfers[i].len);
+			wiringPiSPIDataRW(spiChannel, rx, transfers[i].len);
+			spiCalls++;
+		}
+	}
 
-	payloadSize = max > size ? size : max;
+	lastStatus = ((unsigned char *) transfers[transferCount - 1].rx_buf)[0];
+	transferCount = 0;
+	transactionSize = 0;
+
+	return rxData[0];
 }
 
 /**
- * Set power level
+ * Get retransmission count of the last written payload
  * 
- * @param level 	power level
+ * @return  ARC_CNT
  */
-void ORF24::setPowerLevel(RFPower level)
+int ORF24::getRetryCount(void)
 {
-	if (debug)
-	{
-		std::cout << "Setting up RF power level...\n";
-	}
+	return (observeTX >> ARC_CNT) & 0x0F;
+}
 
-	unsigned char setup = readRegister(RF_SETUP);
+/**
+ * Get lost packet count
+ *
+ * Counts payloads that reached the retry limit, saturates at 15
+ * 
+ * @return  PLOS_CNT
+ */
+int ORF24::getLostCount(void)
+{
+	return (observeTX >> PLOS_CNT) & 0x0F;
+}
 
-	setup &= ~(1 << RF_PWR_LOW | 1 << RF_PWR_HIGH);
+/**
+ * Reset lost packet count
+ */
+void ORF24::resetLostCount(void)
+{
+	unsigned char channel = readRegister(RF_CH);
 
-	switch (level)
-	{
-		case RF_PA_MAX:
-			setup |= (1 << RF_PWR_LOW | 1 << RF_PWR_HIGH);
-			break;
+	/* Any RF_CH write clears PLOS_CNT, even one the shadow would skip */
+	shadowValid &= ~(1 << RF_CH);
+	writeRegister(RF_CH, channel);
+	observeTX &= 0x0F;
+}
 
-		case RF_PA_HIGH:
-			setup |= (1 << RF_PWR_HIGH);
-			break;
+/**
+ * Get duration of the last write
+ *
+ * Measured from the first CE pulse until the transmission ended
+ * 
+ * @return  time in microseconds
+ */
+unsigned int ORF24::getWriteTime(void)
+{
+	return writeTime;
+}
 
-		case RF_PA_LOW:
-			setup |= (1 << RF_PWR_LOW);
-			break;
-	}
+/**
+ * Start an SPI transaction
+ *
+ * Register writes, payload writes and FIFO flushes are queued until
+ * commitTransaction() and then sent in one system call. Starting a
+ * transaction while one is open continues it.
+ */
+void ORF24::beginTransaction(void)
+{
+	inTransaction = true;
+}
 
-	writeRegister(RF_SETUP, setup);
+/**
+ * Send queued SPI commands and end the transaction
+ * 
+ * @return  status clocked out by the first command of the last submit
+ */
+unsigned char ORF24::commitTransaction(void)
+{
+	inTransaction = false;
+
+	return submitTransaction();
+}
+/**
+ * Write payload to send
+ * 
+ * @param  data 	data to send
+ * @param  len  	data length in byte
+ * @return      	nRF24L01 status
+ */
+unsigned char ORF24::writePayload(unsigned char *data, int len)
+{
+	return writePayload(data, len, W_TX_PAYLOAD);
 }
 
 /**
- * Set air data rate
+ * Write payload to send with a given command
  * 
- * @param rate 		data rate
+ * @param  data 	data to send
+ * @param  len  	data length in byte
+ * @param  command 	W_TX_PAYLOAD or W_TX_PAYLOAD_NO_ACK
+ * @return      	nRF24L01 status
  */
-void ORF24::setDataRate(DataRate rate)
+unsigned char ORF24::writePayload(unsigned char *data, int len, unsigned char command)
 {
-	if (debug)
+	unsigned char *p = buffer;
+
+	*p++ = command;
+	
+	for (int i = 0; i < len; i++)
 	{
-		std::cout << "Setting up air data rate...\n";
+		*p++ = *data++;
 	}
 
-	unsigned char setup = readRegister(RF_SETUP);
-
-	setup &= ~(1 << RF_DR);
-
-	if (rate == RF_DR_2MBPS)
+	/* Static payloads are padded to the receiver payload width */
+	if (!dynamicPayloadAvailable)
 	{
-		setup |= (1 << RF_DR);
+		for (; len < payloadSize; len++)
+		{
+			*p++ = 0;
+		}
 	}
 
-	writeRegister(RF_SETUP, setup);	
+	return transfer(buffer, len + 1, false);
 }
 
 /**
- * Set CRC length
+ * Read received payload
  * 
- * @param length 	CRC length
+ * @param  data 	data buffer to read into
+ * @param  len  	data length
+ * @return     		nRF24L01 status
  */
-void ORF24::setCRCLength(CRCLength length)
+unsigned char ORF24::readPayload(unsigned char *data, int len)
 {
-	if (debug)
-	{
-		std::cout << "Setting up CRC...\n";
-	}
-
-	unsigned char config = readRegister(CONFIG);
+	unsigned char *p = buffer;
 
-	config &= ~(1 << CRCO | 1 << EN_CRC);
+	*p++ = R_RX_PAYLOAD;
 
-	switch (length)
+	for (int i = 0; i < len; i++)
 	{
-		case CRC_1_BYTE:
-			config |= (1 << EN_CRC);
-			break;
-
-		case CRC_2_BYTE:
-			config |= (1 << EN_CRC) | (1 << CRCO);
-			break;
+		*p++ = NOP;
 	}
 
-	writeRegister(CONFIG, config);
+	transfer(buffer, len + 1, true);
+	memcpy(data, buffer + 1, len);
+
+	return *buffer;
 }
 
 /**
- * Set auto acknowledgment
+ * Get width of the payload on top of the RX FIFO
  * 
- * @param enable 	enable or disable auto acknowledgment
+ * @return  payload width in byte
  */
-void ORF24::setAutoACK(bool enable)
+int ORF24::getDynamicPayloadSize(void)
 {
-	if (enable)
-	{
-		if (debug)
-		{
-			std::cout << "Enabling Auto Acknowledgment...\n";
-		}
+	unsigned char *p = buffer;
 
-		writeRegister(EN_AA, 0b111111);
-	}
-	else
-	{
-		if (debug)
-		{
-			std::cout << "Disabling Auto Acknowledgment...\n";
-		}
+	*p++ = R_RX_PL_WID;
+	*p = NOP;
 
-		writeRegister(EN_AA, 0);
-	}
+	transfer(buffer, 2, true);
+
+	return *p;
 }
 
 /**
- * Set auto acknowledgment
- * 
- * @param pipe   	pipe number
- * @param enable 	enable or disable auto acknowledgment
+ * Move ack payloads from the RX FIFO to the ack queue
+ *
+ * The oldest waiting payload is overwritten when the queue is full.
  */
-void ORF24::setAutoACK(int pipe, bool enable)
+void ORF24::receiveAckPayloads(void)
 {
-	if (pipe < 6)
+	while (! (readRegister(FIFO_STATUS) & (1 << RX_EMPTY)))
 	{
-		unsigned char aa = readRegister(EN_AA);
+		int width = getDynamicPayloadSize();
 
-		if (enable)
+		/* A width above 32 means a corrupted payload, drop it */
+		if (width > MAX_PAYLOAD_SIZE)
 		{
-			if (debug)
-			{
-				std::cout << "Enabling Auto Acknowledgment on pipe " << pipe << "...\n";
-			}
-
-			aa |= (1 << pipe);
+			flushRX();
+			break;
 		}
-		else
-		{
-			if (debug)
-			{
-				std::cout << "Disabling Auto Acknowledgment on pipe " << pipe << "...\n";
-			}
 
-			aa &= ~(1 << pipe);
+		if (ackPayloadAvailable == ACK_QUEUE_SIZE)
+		{
+			ackPayloadHead = (ackPayloadHead + 1) % ACK_QUEUE_SIZE;
+			ackPayloadAvailable--;
+			ackPayloadDropped++;
 		}
 
-		writeRegister(EN_AA, aa);
+		int slot = (ackPayloadHead + ackPayloadAvailable) % ACK_QUEUE_SIZE;
+
+		readPayload(ackPayload[slot], width);
+		ackPayloadLength[slot] = width;
+		ackPayloadAvailable++;
 	}
 }
 
 /**
- * Flush RX FIFO
- * 
- * @return  status
+ * Enable dynamic payload length on every pipe
+ *
+ * Payloads are no longer padded to the payload size. Needs an
+ * nRF24L01+ on both ends.
  */
-unsigned char ORF24::flushRX(void)
+void ORF24::enableDynamicPayloads(void)
 {
 	if (debug)
 	{
-		std::cout << "Flushing RX FIFO...\n";
+		std::cout << "Enabling dynamic payload length...\n";
 	}
 
-	unsigned char *p = buffer;
-
-	*p = FLUSH_RX;
-
-	wiringPiSPIDataRW(spiChannel, buffer, 1);
-
-	return *buffer;
+	writeRegister(FEATURE, readRegister(FEATURE) | (1 << EN_DPL));
+	writeRegister(DYNPD, 0b111111);
+	dynamicPayloadAvailable = true;
 }
 
 /**
- * Flush TX FIFO
- * 
- * @return  status
+ * Enable payloads in acknowledgement packets
+ *
+ * Receivers can then return data with the ACK of each payload. Turns
+ * on dynamic payload length too.
  */
-unsigned char ORF24::flushTX(void)
+void ORF24::enableAckPayload(void)
 {
 	if (debug)
 	{
-		std::cout << "Flushing TX FIFO...\n";
+		std::cout << "Enabling ack payload...\n";
 	}
 
-	unsigned char *p = buffer;
+	writeRegister(FEATURE, readRegister(FEATURE) | (1 << EN_ACK_PAY) | (1 << EN_DPL));
 
-	*p = FLUSH_TX;
+	/* Ack payloads come back on pipe 0 */
+	writeRegister(DYNPD, readRegister(DYNPD) | (1 << DPL_P0) | (1 << DPL_P1));
+	ackPayloadEnabled = true;
+}
 
-	wiringPiSPIDataRW(spiChannel, buffer, 1);
+/**
+ * Allow payloads that ask for no acknowledgement
+ */
+void ORF24::enableDynamicAck(void)
+{
+	if (debug)
+	{
+		std::cout << "Enabling dynamic acknowledgment...\n";
+	}
 
-	return *buffer;
+	writeRegister(FEATURE, readRegister(FEATURE) | (1 << EN_DYN_ACK));
+	dynamicAckEnabled = true;
+}
+
+/**
+ * Check for a received ack payload
+ * 
+ * @return  true if an ack payload is waiting
+ */
+bool ORF24::isAckPayloadAvailable(void)
+{
+	return ackPayloadAvailable > 0;
+}
+
+/**
+ * Read the oldest received ack payload
+ *
+ * Ack payloads are kept from the start of the last write.
+ * 
+ * @param  data 	buffer to read into
+ * @param  len  	buffer size
+ * @return      	payload width, 0 if none was waiting
+ */
+int ORF24::readAckPayload(unsigned char *data, int len)
+{
+	if (!ackPayloadAvailable)
+		return 0;
+
+	int width = ackPayloadLength[ackPayloadHead];
+
+	memcpy(data, ackPayload[ackPayloadHead], len < width ? len : width);
+	ackPayloadHead = (ackPayloadHead + 1) % ACK_QUEUE_SIZE;
+	ackPayloadAvailable--;
+
+	return width;
+}
+
+/**
+ * Set delay and number of retry for retransmission
+ *
+ * @param delay 	retransmission delay
+ * @param count 	retransmission count
+ */
+void ORF24::setRetries(int delay, int count)
+{
+	if (debug)
+	{
+		std::cout << "Setting up retransmission configuration...\n";
+	}
+
+	writeRegister(SETUP_RETR, (delay & 0xF) << ARD | (count & 0xF) << ARC);
+}
+
+/**
+ * Set RF channel
+ * 
+ * @param channel 	channel number
+ */
+void ORF24::setChannel(int channel)
+{
+	if (debug)
+	{
+		std::cout << "Setting up RF channel...\n";
+	}
+
+	const int max = RF_CHANNELS - 1;
+
+	writeRegister(RF_CH, max > channel ? channel : max);
+}
+
+/**
+ * Get RF channel
+ * 
+ * @return  channel number
+ */
+int ORF24::getChannel(void)
+{
+	return readRegister(RF_CH);
+}
+
+/**
+ * Survey received power on every RF channel
+ *
+ * Listens on each channel in turn and counts the samples where RPD
+ * reports a carrier above -64 dBm. The chip is left powered down on
+ * its previous channel.
+ * 
+ * @param histogram 	RF_CHANNELS counters of busy samples
+ * @param sweeps    	number of passes over all channels
+ */
+void ORF24::scanChannels(int *histogram, int sweeps)
+{
+	if (debug)
+	{
+		std::cout << "Scanning " << RF_CHANNELS << " RF channels...\n";
+	}
+
+	unsigned char channel = readRegister(RF_CH);
+	unsigned char config = readRegister(CONFIG);
+
+	memset(histogram, 0, RF_CHANNELS * sizeof(*histogram));
+
+	setCE(LOW);
+	writeRegister(CONFIG, config | (1 << PWR_UP) | (1 << PRIM_RX));
+	poweredUp = true;
+	poweredUpAt = micros();
+	waitStandby();
+
+	for (int i = 0; i < sweeps; i++)
+	{
+		for (int c = 0; c < RF_CHANNELS; c++)
+		{
+			writeRegister(RF_CH, c);
+
+			/* RPD needs the receiver running for a while before it is valid */
+			setCE(HIGH);
+			delayMicroseconds(RPD_DELAY);
+			setCE(LOW);
+
+			/* CD is RPD on the nRF24L01+ */
+			if (readRegister(CD) & (1 << MD))
+				histogram[c]++;
+		}
+	}
+
+	/* Back to TX mode on the old channel, drop anything heard */
+	beginTransaction();
+	writeRegister(RF_CH, channel);
+	writeRegister(CONFIG, config & ~(1 << PRIM_RX));
+	writeRegister(STATUS, 1 << RX_DR | 1 << TX_DS | 1 << MAX_RT);
+	flushRX();
+	commitTransaction();
+
+	powerDown();
+}
+
+/**
+ * Pick the quietest channel of a survey
+ *
+ * Neighbour channels count too, a 2 Mbps link is 2 MHz wide. Ties go
+ * to the channel closest to the preferred one.
+ * 
+ * @param  histogram 	RF_CHANNELS counters of busy samples
+ * @param  preferred 	channel to keep when it is as quiet as any
+ * @return           	channel number
+ */
+int ORF24::getQuietestChannel(const int *histogram, int preferred)
+{
+	int best = preferred;
+	long bestScore = -1;
+
+	for (int c = 0; c < RF_CHANNELS; c++)
+	{
+		long score = 2L * histogram[c];
+
+		if (c > 0)
+			score += histogram[c - 1];
+		if (c < RF_CHANNELS - 1)
+			score += histogram[c + 1];
+
+		if (bestScore < 0 || score < bestScore ||
+			(score == bestScore && abs(c - preferred) < abs(best - preferred)))
+		{
+			best = c;
+			bestScore = score;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Set payload size
+ * 
+ * @param size 	payload size
+ */
+void ORF24::setPayloadSize(int size)
+{
+	if (debug)
+	{
+		std::cout << "Setting up payload size to " << size << "...\n";
+	}
+
+	const int max = 32;
+
+	payloadSize = max > size ? size : max;
+}
+
+/**
+ * Set power level
+ * 
+ * @param level 	power level
+ */
+void ORF24::setPowerLevel(RFPower level)
+{
+	if (debug)
+	{
+		std::cout << "Setting up RF power level...\n";
+	}
+
+	unsigned char setup = readRegister(RF_SETUP);
+
+	setup &= ~(1 << RF_PWR_LOW | 1 << RF_PWR_HIGH);
+
+	switch (level)
+	{
+		case RF_PA_MAX:
+			setup |= (1 << RF_PWR_LOW | 1 << RF_PWR_HIGH);
+			break;
+
+		case RF_PA_HIGH:
+			setup |= (1 << RF_PWR_HIGH);
+			break;
+
+		case RF_PA_LOW:
+			setup |= (1 << RF_PWR_LOW);
+			break;
+	}
+
+	writeRegister(RF_SETUP, setup);
+}
+
+/**
+ * Set air data rate
+ * 
+ * @param rate 		data rate
+ */
+void ORF24::setDataRate(DataRate rate)
+{
+	if (debug)
+	{
+		std::cout << "Setting up air data rate...\n";
+	}
+
+	unsigned char setup = readRegister(RF_SETUP);
+
+	setup &= ~(1 << RF_DR);
+
+	if (rate == RF_DR_2MBPS)
+	{
+		setup |= (1 << RF_DR);
+	}
+
+	writeRegister(RF_SETUP, setup);	
+}
+
+/**
+ * Set CRC length
+ * 
+ * @param length 	CRC length
+ */
+void ORF24::setCRCLength(CRCLength length)
+{
+	if (debug)
+	{
+		std::cout << "Setting up CRC...\n";
+	}
+
+	unsigned char config = readRegister(CONFIG);
+
+	config &= ~(1 << CRCO | 1 << EN_CRC);
+
+	switch (length)
+	{
+		case CRC_1_BYTE:
+			config |= (1 << EN_CRC);
+			break;
+
+		case CRC_2_BYTE:
+			config |= (1 << EN_CRC) | (1 << CRCO);
+			break;
+	}
+
+	writeRegister(CONFIG, config);
+}
+
+/**
+ * Set auto acknowledgment
+ * 
+ * @param enable 	enable or disable auto acknowledgment
+ */
+void ORF24::setAutoACK(bool enable)
+{
+	if (enable)
+	{
+		if (debug)
+		{
+			std::cout << "Enabling Auto Acknowledgment...\n";
+		}
+
+		writeRegister(EN_AA, 0b111111);
+	}
+	else
+	{
+		if (debug)
+		{
+			std::cout << "Disabling Auto Acknowledgment...\n";
+		}
+
+		writeRegister(EN_AA, 0);
+	}
+}
+
+/**
+ * Set auto acknowledgment
+ * 
+ * @param pipe   	pipe number
+ * @param enable 	enable or disable auto acknowledgment
+ */
+void ORF24::setAutoACK(int pipe, bool enable)
+{
+	if (pipe < 6)
+	{
+		unsigned char aa = readRegister(EN_AA);
+
+		if (enable)
+		{
+			if (debug)
+			{
+				std::cout << "Enabling Auto Acknowledgment on pipe " << pipe << "...\n";
+			}
+
+			aa |= (1 << pipe);
+		}
+		else
+		{
+			if (debug)
+			{
+				std::cout << "Disabling Auto Acknowledgment on pipe " << pipe << "...\n";
+			}
+
+			aa &= ~(1 << pipe);
+		}
+
+		writeRegister(EN_AA, aa);
+	}
+}
+
+/**
+ * Flush RX FIFO
+ * 
+ * @return  status
+ */
+unsigned char ORF24::flushRX(void)
+{
+	if (debug)
+	{
+		std::cout << "Flushing RX FIFO...\n";
+	}
+
+	unsigned char *p = buffer;
+
+	*p = FLUSH_RX;
+
+	return transfer(buffer, 1, false);
+}
+
+/**
+ * Flush TX FIFO
+ * 
+ * @return  status
+ */
+unsigned char ORF24::flushTX(void)
+{
+	if (debug)
+	{
+		std::cout << "Flushing TX FIFO...\n";
+	}
+
+	unsigned char *p = buffer;
+
+	*p = FLUSH_TX;
+
+	return transfer(buffer, 1, false);
+}
+
+/**
+ * Get RF status register
+ * 
+ * @return  status register
+ */
+unsigned char ORF24::getStatus(void)
+{
+	unsigned char *p = buffer;
+
+	*p = NOP;
+
+	return transfer(buffer, 1, true);
+}
+
+/**
+ * Write payload to open writing pipe
+ * 
+ * @param  data 	data to write
+ * @param  len  	data length
+ * @return      	status
+ */
+bool ORF24::write(unsigned char *data, int len)
+{
+	return write(data, len, false);
+}
+
+/**
+ * Write payload to open writing pipe, optionally without ACK
+ *
+ * A multicast payload is sent once and no receiver acknowledges it,
+ * so any number of receivers can listen on the address. Needs
+ * enableDynamicAck().
+ * 
+ * @param  data 		data to write
+ * @param  len  		data length
+ * @param  multicast 	skip the acknowledgement
+ * @return      		true if the payload was acknowledged, or sent for multicast
+ */
+bool ORF24::write(unsigned char *data, int len, bool multicast)
+{
+	unsigned char command = multicast && dynamicAckEnabled ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD;
+
+	if (debug)
+	{
+		std::cout << "\nSending payload: ";
+		for (int i = 0; i < len; i++)
+		{
+			printf("%X", *(data+i));
+		}
+		printf("\n");
+	}
+
+	if (irq >= 0)
+	{
+		unsigned long count = getIrqCount();
+
+		startWrite(data, len, command);
+
+		std::unique_lock<std::mutex> lock(irqMutex);
+		irqSignal.wait_for(lock, std::chrono::milliseconds(WRITE_TIMEOUT),
+			[this, count] { return irqCount != count; });
+	}
+	else
+	{
+		startWrite(data, len, command);
+
+		unsigned char observeTX, status;
+		int sentAt = millis();
+		const unsigned long timeout = WRITE_TIMEOUT;
+
+		do
+		{
+			status = readRegister(OBSERVE_TX, &observeTX, 1);
+		} while (! (status & (1 << TX_DS | 1 << MAX_RT)) && (millis() - sentAt < timeout));
+	}
+
+	return finishWrite();
+}
+
+/**
+ * Finish a transmission
+ *
+ * Clears the status flags, powers down and flushes the TX FIFO
+ * 
+ * @return  true if the payload was acknowledged
+ */
+bool ORF24::finishWrite(void)
+{
+	bool result = false;
+	bool txOK, txFail, rxReady;
+	unsigned char status;
+
+	status = endWrite();
+	txOK = status & (1 << TX_DS);
+	txFail = status & (1 << MAX_RT);
+	rxReady = status & (1 << RX_DR);
+
+	result = txOK;
+
+	if (debug)
+	{
+		if (result)
+		{
+			std::cout << "Sending payload success.\n";
+		}
+		else
+		{
+			std::cout <<  "Sending payload failed.\n";
+		}
+	}
+
+	return result;
+}
+
+/**
+ * Clear status, power down if allowed and flush TX FIFO
+ * 
+ * @return  status before clearing
+ */
+unsigned char ORF24::endWrite(void)
+{
+	observeTX = readRegister(OBSERVE_TX);
+	writeTime = micros() - writeStartedAt;
+
+	/* The OBSERVE_TX read clocked out a fresh STATUS */
+	if (ackPayloadEnabled && lastStatus & (1 << RX_DR))
+		receiveAckPayloads();
+
+	beginTransaction();
+
+	writeRegister(STATUS, 1 << RX_DR | 1 << TX_DS | 1 << MAX_RT);
+	lastActivity = millis();
+
+	if (powerPolicy != STANDBY_IN_SESSION || !inSession)
+		powerDown();
+
+	flushTX();
+
+	return commitTransaction();
+}
+
+/**
+ * Start writing payload
+ * 
+ * @param data 	data to write
+ * @param len  	data length
+ */
+void ORF24::startWrite(unsigned char *data, int len)
+{
+	startWrite(data, len, W_TX_PAYLOAD);
 }
 
 /**
- * Get RF status register
+ * Start writing payload with a given command
  * 
- * @return  status register
+ * @param data 		data to write
+ * @param len  		data length
+ * @param command 	W_TX_PAYLOAD or W_TX_PAYLOAD_NO_ACK
  */
-unsigned char ORF24::getStatus(void)
+void ORF24::startWrite(unsigned char *data, int len, unsigned char command)
 {
-	unsigned char *p = buffer;
+	ackPayloadAvailable = 0;
 
-	*p = NOP;
+	beginTransaction();
+	prepareWrite();
+	writePayload(data, len, command);
+	commitTransaction();
 
-	wiringPiSPIDataRW(spiChannel, buffer, 1);
+	waitStandby();
+	writeStartedAt = micros();
+	setCE(HIGH);
+	delayMicroseconds(15);
+	setCE(LOW);
+}
 
-	return *buffer;
+/**
+ * Leave power down and select TX mode
+ *
+ * Oscillator start-up is only paid when the chip is powered down. The
+ * caller waits for it with waitStandby() before raising CE.
+ */
+void ORF24::prepareWrite(void)
+{
+	if (poweredUp)
+		return;
+
+	unsigned char config = readRegister(CONFIG);
+	config |= (1 << PWR_UP);
+	config &= ~(1 << PRIM_RX);
+	writeRegister(CONFIG, config);
+	poweredUp = true;
+	poweredUpAt = micros();
 }
 
 /**
- * Write payload to open writing pipe
+ * Wait until the oscillator has started after power up
+ */
+void ORF24::waitStandby(void)
+{
+	unsigned int elapsed = micros() - poweredUpAt;
+
+	if (elapsed < POWER_UP_DELAY)
+		delayMicroseconds(POWER_UP_DELAY - elapsed);
+}
+
+/**
+ * Wait for the next transmission event
+ *
+ * Sleeps on the IRQ in IRQ mode, otherwise returns at once so the
+ * caller polls STATUS.
+ *
+ * @param seen 	IRQ count already handled, updated on return
+ */
+void ORF24::waitTransmission(unsigned long *seen)
+{
+	if (irq < 0)
+		return;
+
+	/* Completions that land before STATUS is cleared raise no new edge */
+	std::unique_lock<std::mutex> lock(irqMutex);
+	irqSignal.wait_for(lock, std::chrono::milliseconds(1),
+		[this, seen] { return irqCount != *seen; });
+	*seen = irqCount;
+}
+
+/**
+ * Get the number of IRQ edges seen
+ *
+ * @return  IRQ count
+ */
+unsigned long ORF24::getIrqCount(void)
+{
+	std::lock_guard<std::mutex> lock(irqMutex);
+
+	return irqCount;
+}
+
+/**
+ * Write several payloads in one air burst
+ *
+ * The TX FIFO is kept full and CE is held high across payloads. A
+ * payload that reaches the retry limit is dropped and the rest of the
+ * burst goes on.
  * 
- * @param  data 	data to write
- * @param  len  	data length
- * @return      	status
+ * @param  payloads 	payloads to write
+ * @param  lengths  	payload lengths
+ * @param  count    	number of payloads
+ * @param  results  	per payload acknowledgement, may be null
+ * @return          	number of acknowledged payloads
  */
-bool ORF24::write(unsigned char *data, int len)
+int ORF24::writeBurst(unsigned char *const *payloads, const int *lengths, int count, bool *results)
 {
-	bool result = false;
+	BurstAccount burst(count, results, burstDepth);
+	unsigned int startedAt = millis();
+	unsigned long seen = getIrqCount();
 
-	if (debug)
+	ackPayloadAvailable = 0;
+
+	/* The first payloads go out with the power up */
+	beginTransaction();
+	prepareWrite();
+
+	while (burst.canLoad())
 	{
-		std::cout << "\nSending payload: ";
-		for (int i = 0; i < len; i++)
+		int i = burst.next();
+		writePayload(payloads[i], lengths[i]);
+	}
+
+	commitTransaction();
+	waitStandby();
+	writeStartedAt = micros();
+	setCE(HIGH);
+
+	while (!burst.isDone() && millis() - startedAt <= WRITE_TIMEOUT)
+	{
+		unsigned char status = getStatus();
+
+		/* The RX FIFO only holds three ack payloads */
+		if (ackPayloadEnabled && status & (1 << RX_DR))
 		{
-			printf("%X", *(data+i));
+			receiveAckPayloads();
+			writeRegister(STATUS, 1 << RX_DR);
 		}
-		printf("\n");
+
+		beginTransaction();
+
+		if (status & (1 << TX_DS))
+		{
+			writeRegister(STATUS, 1 << TX_DS);
+			burst.onSent();
+		}
+
+		if (status & (1 << MAX_RT))
+		{
+			/* The head payload failed, reload the ones without a result */
+			setCE(LOW);
+			writeRegister(STATUS, 1 << MAX_RT);
+			flushTX();
+			commitTransaction();
+
+			burst.onFailed();
+			continue;
+		}
+
+		/* Keep the FIFO full */
+		while (burst.canLoad())
+		{
+			int i = burst.next();
+			writePayload(payloads[i], lengths[i]);
+		}
+
+		commitTransaction();
+		setCE(HIGH);
+
+		/* Catch up on completions that shared one TX_DS flag */
+		if (burst.inFlight() && readRegister(FIFO_STATUS) & (1 << TX_EMPTY))
+			burst.onEmpty();
+
+		if (burst.inFlight())
+			waitTransmission(&seen);
+	}
+
+	burst.finish();
+
+	setCE(LOW);
+	endWrite();
+
+	if (debug)
+	{
+		std::cout << "Burst of " << count << " payloads, " << burst.getAcked() << " acknowledged, "
+				  << burst.getResent() << " resent after an unattributable failure.\n";
+	}
+
+	return burst.getAcked();
+}
+
+/**
+ * Start writing payload asynchronously
+ *
+ * The callback runs from completeWrite() on the calling thread once the
+ * transmission ends. Only one write may be in flight. Without IRQ mode,
+ * the write blocks and the callback runs before this method returns.
+ * 
+ * @param data 		data to write
+ * @param len  		data length
+ * @param callback 	completion callback
+ * @param userData 	callback argument
+ */
+void ORF24::startWrite(unsigned char *data, int len, WriteCallback callback, void *userData)
+{
+	if (irq < 0)
+	{
+		bool result = write(data, len);
+
+		if (callback)
+			callback(result, userData);
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(irqMutex);
+		writeCallback = callback;
+		writeUserData = userData;
+		writeIrqCount = irqCount;
 	}
 
 	startWrite(data, len);
+}
 
-	unsigned char observeTX, status;
-	int sentAt = millis();
-	const unsigned long timeout = 500;
+/**
+ * Complete an asynchronous write
+ *
+ * Waits for the IRQ of the pending write, then finishes it and runs its
+ * callback. A write without IRQ after WRITE_TIMEOUT completes as failed.
+ * 
+ * @param  timeout 	maximum waiting time in miliseconds
+ * @return         	true if no write is pending anymore
+ */
+bool ORF24::completeWrite(int timeout)
+{
+	WriteCallback callback;
+	void *userData;
 
-	do
 	{
-		status = readRegister(OBSERVE_TX, &observeTX, 1);
-	} while (! (status & (1 << TX_DS | 1 << MAX_RT)) && (millis() - sentAt < timeout));
+		std::unique_lock<std::mutex> lock(irqMutex);
 
-	bool txOK, txFail, rxReady;
+		if (!writeCallback)
+			return true;
 
-	status = writeRegister(STATUS, 1 << RX_DR | 1 << TX_DS | 1 << MAX_RT);
-	txOK = status & (1 << TX_DS);
-	txFail = status & (1 << MAX_RT);
-	rxReady = status & (1 << RX_DR);
+		bool ended = irqSignal.wait_for(lock, std::chrono::milliseconds(timeout),
+			[this] { return irqCount != writeIrqCount; });
 
-	result = txOK;
+		if (!ended && micros() - writeStartedAt < WRITE_TIMEOUT * 1000)
+			return false;
+
+		callback = writeCallback;
+		userData = writeUserData;
+		writeCallback = NULL;
+	}
+
+	callback(finishWrite(), userData);
+
+	return true;
+}
 
+/**
+ * Enable IRQ driven transmission
+ *
+ * The IRQ line is watched by a wiringPi ISR, so writes sleep instead of
+ * polling the status register. Only one ORF24 instance can use the IRQ.
+ * 
+ * @param  pin 	wiringPi pin wired to the nRF24L01 IRQ
+ * @return     	status
+ */
+bool ORF24::enableIRQ(int pin)
+{
 	if (debug)
 	{
-		if (result)
+		std::cout << "Enabling IRQ on pin " << pin << "...\n";
+	}
+
+	pinMode(pin, INPUT);
+	pullUpDnControl(pin, PUD_UP);
+
+	/* Only transmission results pull the IRQ line low */
+	unsigned char config = readRegister(CONFIG);
+	config |= (1 << MASK_RX_DR);
+	config &= ~((1 << MASK_TX_DS) | (1 << MASK_MAX_RT));
+	writeRegister(CONFIG, config);
+
+	irqInstance = this;
+
+	if (wiringPiISR(pin, INT_EDGE_FALLING, &ORF24::irqHandler) < 0)
+	{
+		if (debug)
 		{
-			std::cout << "Sending payload success.\n";
+			std::cout << "Unable to register IRQ handler.\n";
 		}
-		else
+
+		irqInstance = NULL;
+		return false;
+	}
+
+	irq = pin;
+
+	return true;
+}
+
+/**
+ * Set burst depth
+ *
+ * @param depth 	payloads in flight during writeBurst(), 1 to TX_FIFO_DEPTH
+ */
+void ORF24::setBurstDepth(int depth)
+{
+	burstDepth = depth < 1 ? 1 : depth > TX_FIFO_DEPTH ? TX_FIFO_DEPTH : depth;
+}
+
+/**
+ * Drive CE through the GPIO character device
+ *
+ * CE is toggled for every payload, the line request turns each toggle
+ * into one ioctl without going through wiringPi. Call after begin().
+ * 
+ * @param  chip 	GPIO chip device
+ * @return      	status
+ */
+bool ORF24::enableGpioChip(const char *chip)
+{
+	int line = wpiPinToGpio(ce);
+
+	if (!ceLine.requestOutput(chip, &line, 1, false, 0))
+	{
+		if (debug)
 		{
-			std::cout <<  "Sending payload failed.\n";
+			std::cout << "Unable to request CE line " << line << " from " << chip << ".\n";
 		}
-	}
 
-	powerDown();
+		return false;
+	}
 
-	flushTX();
+	return true;
+}
 
-	return result;
+/**
+ * Drive the CE pin
+ * 
+ * @param level 	HIGH or LOW
+ */
+void ORF24::setCE(int level)
+{
+	if (ceLine.isOpen())
+		ceLine.setValues(level == HIGH ? 1 : 0, 1);
+	else
+		digitalWrite(ce, level);
 }
 
 /**
- * Start writing payload
+ * Check IRQ driven transmission
  * 
- * @param data 	data to write
- * @param len  	data length
+ * @return  true if IRQ mode is enabled
  */
-void ORF24::startWrite(unsigned char *data, int len)
+bool ORF24::isIRQEnabled(void)
 {
-	unsigned char config = readRegister(CONFIG);
-	config |= (1 << PWR_UP);
-	config &= ~(1 << PRIM_RX);
-	writeRegister(CONFIG, config);
+	return irq >= 0;
+}
 
-	delayMicroseconds(150);
+/**
+ * Handle IRQ edge
+ *
+ * Only counts the edge and wakes up waiting writers, SPI stays with
+ * the thread that issued the write
+ */
+void ORF24::onInterrupt(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(irqMutex);
+		irqCount++;
+	}
 
-	writePayload(data, len);
+	irqSignal.notify_all();
+}
 
-	digitalWrite(ce, HIGH);
-	delayMicroseconds(15);
-	digitalWrite(ce, LOW);
+/**
+ * IRQ service routine registered with wiringPi
+ */
+void ORF24::irqHandler(void)
+{
+	if (irqInstance)
+		irqInstance->onInterrupt();
 }
 
 /**
@@ -563,6 +1536,8 @@ void ORF24::powerUp(void)
 	}
 
 	writeRegister(CONFIG, config);
+	poweredUp = true;
+	poweredUpAt = micros();
 }
 
 /**
@@ -580,6 +1555,83 @@ void ORF24::powerDown(void)
 	}
 
 	writeRegister(CONFIG, config);
+	poweredUp = false;
+}
+
+/**
+ * Set power policy
+ *
+ * With STANDBY_IN_SESSION the chip stays in Standby-I between writes
+ * of a session, and only powers down after the idle timeout or at the
+ * end of the session.
+ * 
+ * @param policy 	power policy
+ * @param timeout 	idle timeout in milliseconds
+ */
+void ORF24::setPowerPolicy(PowerPolicy policy, unsigned int timeout)
+{
+	powerPolicy = policy;
+	idleTimeout = timeout;
+}
+
+/**
+ * Begin power session
+ *
+ * Starts the oscillator early, the first write only waits for what is
+ * left of the start-up time
+ */
+void ORF24::beginSession(void)
+{
+	inSession = true;
+	lastActivity = millis();
+
+	if (powerPolicy == STANDBY_IN_SESSION && !poweredUp)
+		powerUp();
+}
+
+/**
+ * End power session
+ */
+void ORF24::endSession(void)
+{
+	inSession = false;
+
+	if (poweredUp)
+		powerDown();
+}
+
+/**
+ * Check power session
+ * 
+ * @return  true if a session is running
+ */
+bool ORF24::isInSession(void)
+{
+	return inSession;
+}
+
+/**
+ * Get Standby-I time left
+ * 
+ * @return  milliseconds until idle power down, -1 if powered down
+ */
+int ORF24::getStandbyTimeLeft(void)
+{
+	if (!poweredUp)
+		return -1;
+
+	unsigned int idle = millis() - lastActivity;
+
+	return idle >= idleTimeout ? 0 : idleTimeout - idle;
+}
+
+/**
+ * Power down if the idle timeout has passed
+ */
+void ORF24::powerDownIfIdle(void)
+{
+	if (poweredUp && millis() - lastActivity >= idleTimeout)
+		powerDown();
 }
 
 /**
@@ -669,6 +1721,58 @@ void ORF24::openReadingPipe(int pipe, const char *address)
 	}
 }
 
+/**
+ * Forget the register shadow
+ *
+ * Call it when the chip may have been reset behind our back
+ */
+void ORF24::invalidateCache(void)
+{
+	shadowValid = 0;
+
+	for (int i = 0; i < 3; i++)
+	{
+		addressValid[i] = false;
+	}
+}
+
+/**
+ * Get register shadow hit count
+ * 
+ * @return  SPI transfers saved by the shadow
+ */
+unsigned long ORF24::getCacheHits(void)
+{
+	return cacheHits;
+}
+
+/**
+ * Get register shadow miss count
+ * 
+ * @return  SPI transfers of cacheable registers
+ */
+unsigned long ORF24::getCacheMisses(void)
+{
+	return cacheMisses;
+}
+
+/**
+ * Print register shadow and SPI statistics in debug mode
+ */
+void ORF24::printSPIStatistics(void)
+{
+	if (debug)
+	{
+		std::cout << "Register cache: " << cacheHits << " hits, "
+				  << cacheMisses << " misses.\n";
+		std::cout << "SPI: " << spiTransfers << " commands in "
+				  << spiCalls << " system calls.\n";
+
+		if (ackPayloadEnabled)
+			std::cout << "Ack payloads: " << ackPayloadDropped << " dropped.\n";
+	}
+}
+
 /**
  * Enable debugging information
  */
@@ -0,0 +1,1084 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "RadioService.h"
+
+/**
+ * RadioService Class Constructor
+ *
+ * @param _rf 	initialized radio transceiver
+ */
+RadioService::RadioService(ORF24 *_rf) : rf(_rf), running(false), session(false), legacy(false), channel(HOME_CHANNEL), drainJobs(0), drainRequest(0), drainDone(0)
+{
+	sem_init(&pending, 0, 0);
+
+	for (int hand = 0; hand < 2; hand++)
+	{
+		LinkStats *l = &link[hand];
+
+		memset(l, 0, sizeof(*l));
+		l->successRate = 1;
+		l->rate = RF_DR_1MBPS;
+		l->channel = HOME_CHANNEL;
+		l->retryDelay = 0;
+		l->retryCount = 15;
+		l->upgradeAfter = LINK_CLEAN_WRITES;
+		l->reportedMissed = -1;
+	}
+
+	resetStatistics();
+}
+
+/**
+ * RadioService Class Destructor
+ */
+RadioService::~RadioService()
+{
+	stop();
+	sem_destroy(&pending);
+}
+
+/**
+ * Start worker thread
+ */
+void RadioService::start(void)
+{
+	if (running)
+		return;
+
+	running = true;
+	worker = std::thread(&RadioService::run, this);
+}
+
+/**
+ * Stop worker thread
+ *
+ * Commands already in the queue are sent before the worker exits.
+ */
+void RadioService::stop(void)
+{
+	if (!running)
+		return;
+
+	running = false;
+	sem_post(&pending);
+	worker.join();
+}
+
+/**
+ * Worker thread routine
+ */
+void RadioService::run(void)
+{
+	FeedbackCommand batch[FEEDBACK_BATCH_SIZE];
+
+	while (1)
+	{
+		if (!waitPending())
+		{
+			rf->powerDownIfIdle();
+			continue;
+		}
+
+		if (session != rf->isInSession())
+		{
+			if (session)
+				rf->beginSession();
+			else
+				rf->endSession();
+		}
+
+		unsigned int depth = queue.size();
+		if (depth > maxDepth)
+			maxDepth = depth;
+
+		int count = 0;
+		while (count < FEEDBACK_BATCH_SIZE && queue.pop(&batch[count]))
+			count++;
+
+		if (count)
+			transmit(batch, count);
+		else if (!running)
+			break;
+
+		if (queue.empty())
+		{
+			int jobs;
+			unsigned long request;
+
+			{
+				std::lock_guard<std::mutex> lock(drainMutex);
+				jobs = drainJobs;
+				request = drainRequest;
+				drainJobs = 0;
+			}
+
+			runDrainJobs(jobs);
+
+			{
+				std::lock_guard<std::mutex> lock(drainMutex);
+				drainDone = request;
+			}
+
+			drainSignal.notify_all();
+		}
+	}
+}
+
+/**
+ * Wait for a queued command or a session change
+ *
+ * While the radio is held in Standby-I, the wait ends at the idle
+ * timeout.
+ *
+ * @return  false if the idle timeout passed
+ */
+bool RadioService::waitPending(void)
+{
+	int left = rf->getStandbyTimeLeft();
+
+	if (left < 0)
+	{
+		while (sem_wait(&pending) && errno == EINTR);
+		return true;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += left / 1000;
+	deadline.tv_nsec += (left % 1000) * 1000000L;
+
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	int result;
+	while ((result = sem_timedwait(&pending, &deadline)) && errno == EINTR);
+
+	return result == 0;
+}
+
+/**
+ * Wait until the worker has emptied the queue and run the given jobs
+ *
+ * Runs the jobs on the calling thread if the worker is stopped.
+ *
+ * @param jobs 	DRAIN_* flags
+ */
+void RadioService::runWhenDrained(int jobs)
+{
+	if (!running)
+	{
+		runDrainJobs(jobs);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(drainMutex);
+
+	drainJobs |= jobs;
+	unsigned long target = ++drainRequest;
+	sem_post(&pending);
+
+	drainSignal.wait(lock, [this, target] { return drainDone >= target; });
+}
+
+/**
+ * Run drain jobs and copy the link statistics
+ *
+ * Called by the worker with an empty queue.
+ *
+ * @param jobs 	DRAIN_* flags
+ */
+void RadioService::runDrainJobs(int jobs)
+{
+	/* The SPI counters belong to the thread that runs the transactions */
+	if (jobs & DRAIN_PRINT_RADIO)
+		rf->printSPIStatistics();
+
+	if (jobs & DRAIN_RESET)
+	{
+		for (int hand = 0; hand < 2; hand++)
+		{
+			link[hand].acked = 0;
+			link[hand].failed = 0;
+			link[hand].retries = 0;
+			link[hand].lost = 0;
+			link[hand].telemetry = 0;
+			link[hand].missed = 0;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(drainMutex);
+	linkSnapshot[0] = link[0];
+	linkSnapshot[1] = link[1];
+}
+
+/**
+ * Send a batch of commands with the radio
+ *
+ * Broadcast commands split the batch, so they keep their order
+ * against the commands around them.
+ *
+ * @param commands 	feedback commands
+ * @param count 	number of commands
+ */
+void RadioService::transmit(FeedbackCommand *commands, int count)
+{
+	int first = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (commands[i].hand != BROADCAST)
+			continue;
+
+		if (i > first)
+			transmitHands(&commands[first], i - first);
+
+		transmitBroadcast(&commands[i]);
+		first = i + 1;
+	}
+
+	if (count > first)
+		transmitHands(&commands[first], count - first);
+}
+
+/**
+ * Send commands that are addressed to one hand
+ *
+ * Commands are grouped by hand, each group goes out in one burst.
+ *
+ * @param commands 	feedback commands
+ * @param count 	number of commands
+ */
+void RadioService::transmitHands(FeedbackCommand *commands, int count)
+{
+	unsigned char *payloads[FEEDBACK_BATCH_SIZE];
+	int lengths[FEEDBACK_BATCH_SIZE];
+	bool results[FEEDBACK_BATCH_SIZE];
+	FeedbackCommand *group[FEEDBACK_BATCH_SIZE];
+
+	for (int hand = 0; hand < 2; hand++)
+	{
+		int n = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			if (commands[i].hand != hand)
+				continue;
+
+			/* Resent frames keep their number */
+			if (commands[i].length == SEQUENCED_FEEDBACK_SIZE)
+				commands[i].payload[SEQUENCED_FEEDBACK_SIZE - 1] = ++link[hand].sequence;
+
+			group[n] = &commands[i];
+			payloads[n] = commands[i].payload;
+			lengths[n] = commands[i].length;
+			n++;
+		}
+
+		if (!n)
+			continue;
+
+		transmitHand(hand, payloads, lengths, n, results);
+
+		for (int i = 0; i < n; i++)
+			account(group[i], results[i]);
+	}
+}
+
+/**
+ * Send payloads to one hand with its link settings
+ *
+ * Payloads that fail at 2 Mbps are sent again at 1 Mbps, and payloads
+ * that fail away from HOME_CHANNEL are sent again there, in case the
+ * module has already fallen back.
+ *
+ * @param hand 		0 for right hand, 1 for left hand
+ * @param payloads 	payloads to send
+ * @param lengths 	payload lengths
+ * @param n 		number of payloads
+ * @param results 	per payload acknowledgement
+ */
+void RadioService::transmitHand(int hand, unsigned char **payloads, int *lengths, int n, bool *results)
+{
+	LinkStats *l = &link[hand];
+
+	applyLink(hand);
+
+	if (n == 1)
+		results[0] = rf->write(payloads[0], lengths[0]);
+	else
+		rf->writeBurst(payloads, lengths, n, results);
+
+	updateLink(hand, results, n);
+
+	int failures = 0;
+	for (int i = 0; i < n; i++)
+		if (!results[i])
+			failures++;
+
+	if (failures && l->rate != RF_DR_1MBPS)
+	{
+		/* Tell the module if it still hears us, it falls back by itself otherwise */
+		configureLink(hand, RF_DR_1MBPS);
+		l->rate = RF_DR_1MBPS;
+		l->upgradeAfter = std::min(l->upgradeAfter * 2, LINK_MAX_CLEAN_WRITES);
+
+		failures -= retryFailed(hand, payloads, lengths, n, results);
+	}
+	else if (failures && l->lostUpgrade && timestamp() - l->lostUpgrade < LINK_FALLBACK_TIMEOUT * 1000LL)
+	{
+		/* The module may have switched to 2 Mbps with only its ACK lost,
+		 * it heard us last when it got the request */
+		long long lastAck = l->lastAck;
+		l->rate = RF_DR_2MBPS;
+		l->lastAck = l->lostUpgrade;
+
+		int acked = retryFailed(hand, payloads, lengths, n, results);
+		if (acked)
+		{
+			failures -= acked;
+			l->lastAck = timestamp();
+		}
+		else
+		{
+			l->rate = RF_DR_1MBPS;
+			l->lastAck = lastAck;
+		}
+	}
+
+	l->lostUpgrade = 0;
+
+	if (failures && l->channel != HOME_CHANNEL)
+	{
+		/* The module may have gone home after a quiet spell */
+		l->channel = HOME_CHANNEL;
+
+		if (!retryFailed(hand, payloads, lengths, n, results))
+			l->channel = channel;
+	}
+	else if (!failures && !legacy && l->rate == RF_DR_1MBPS && l->cleanWrites >= l->upgradeAfter)
+	{
+		/* A clean link at 1 Mbps is worth half the air time */
+		if (configureLink(hand, RF_DR_2MBPS))
+		{
+			l->rate = RF_DR_2MBPS;
+			l->lastAck = timestamp();
+		}
+		else
+		{
+			l->upgradeAfter = std::min(l->upgradeAfter * 2, LINK_MAX_CLEAN_WRITES);
+			l->lostUpgrade = timestamp();
+		}
+
+		l->cleanWrites = 0;
+	}
+}
+
+/**
+ * Send a command to both hands without acknowledgement
+ *
+ * Hands that listen on different link settings get one copy each.
+ *
+ * @param command 	feedback command
+ */
+void RadioService::transmitBroadcast(FeedbackCommand *command)
+{
+	bool success = false;
+
+	for (int hand = 0; hand < 2; hand++)
+	{
+		if (hand == 1 && link[1].channel == link[0].channel && link[1].rate == link[0].rate)
+			break;
+
+		tuneLink(hand);
+
+		rf->beginTransaction();
+		rf->openWritingPipe(BROADCAST_ADDRESS);
+
+		success = rf->write(command->payload, command->length, true) || success;
+	}
+
+	account(command, success);
+}
+
+/**
+ * Send the failed payloads of a write again
+ *
+ * @param  hand 		0 for right hand, 1 for left hand
+ * @param  payloads 	payloads of the write
+ * @param  lengths 		payload lengths
+ * @param  n 			number of payloads
+ * @param  results 		per payload acknowledgement, updated
+ * @return          	number of payloads acknowledged now
+ */
+int RadioService::retryFailed(int hand, unsigned char **payloads, int *lengths, int n, bool *results)
+{
+	unsigned char *retryPayloads[FEEDBACK_BATCH_SIZE];
+	int retryLengths[FEEDBACK_BATCH_SIZE];
+	bool retryResults[FEEDBACK_BATCH_SIZE];
+	int index[FEEDBACK_BATCH_SIZE];
+	int m = 0;
+	int acked = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		if (results[i])
+			continue;
+
+		retryPayloads[m] = payloads[i];
+		retryLengths[m] = lengths[i];
+		index[m++] = i;
+	}
+
+	if (!m)
+		return 0;
+
+	applyLink(hand);
+
+	if (m == 1)
+		retryResults[0] = rf->write(retryPayloads[0], retryLengths[0]);
+	else
+		rf->writeBurst(retryPayloads, retryLengths, m, retryResults);
+
+	updateLink(hand, retryResults, m);
+
+	for (int i = 0; i < m; i++)
+	{
+		results[index[i]] = retryResults[i];
+
+		if (retryResults[i])
+			acked++;
+	}
+
+	return acked;
+}
+
+/**
+ * Apply the link settings of a hand to the radio
+ *
+ * @param hand 	0 for right hand, 1 for left hand
+ */
+void RadioService::applyLink(int hand)
+{
+	tuneLink(hand);
+
+	/* The address goes out with the first payloads */
+	rf->beginTransaction();
+	rf->openWritingPipe(hand ? LEFT_HAND_ADDRESS : RIGHT_HAND_ADDRESS);
+}
+
+/**
+ * Tune the radio to the channel and data rate of a hand
+ *
+ * Leaves the writing pipe to the caller
+ *
+ * @param hand 	0 for right hand, 1 for left hand
+ */
+void RadioService::tuneLink(int hand)
+{
+	LinkStats *l = &link[hand];
+
+	/* A quiet module has returned to 1 Mbps by now */
+	if (l->rate != RF_DR_1MBPS && timestamp() - l->lastAck > LINK_FALLBACK_TIMEOUT * 1000LL)
+		l->rate = RF_DR_1MBPS;
+
+	if (l->channel != HOME_CHANNEL && timestamp() - l->lastAck > CHANNEL_FALLBACK_TIMEOUT * 1000LL)
+		l->channel = HOME_CHANNEL;
+
+	/* Unchanged settings cost no SPI traffic with the register shadow */
+	rf->setChannel(l->channel);
+	rf->setDataRate(l->rate);
+	rf->setRetries(l->retryDelay, l->retryCount);
+
+	/* A lost ACK leaves the module on the new channel, look for it there */
+	if (!legacy && l->channel != channel && (hopChannel(hand, channel) || probeChannel(hand, channel)))
+	{
+		l->channel = channel;
+		l->lastAck = timestamp();
+		rf->setChannel(l->channel);
+	}
+}
+
+/**
+ * Update link quality after a write and adapt retransmission
+ *
+ * @param hand 		0 for right hand, 1 for left hand
+ * @param results 	per payload acknowledgement
+ * @param n 		number of payloads
+ */
+void RadioService::updateLink(int hand, const bool *results, int n)
+{
+	LinkStats *l = &link[hand];
+	int retries = rf->getRetryCount();
+	int lost = rf->getLostCount();
+	bool clean = retries == 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		if (results[i])
+			l->acked++;
+		else
+			l->failed++;
+
+		clean = clean && results[i];
+		l->successRate += ((results[i] ? 1.0 : 0.0) - l->successRate) / LINK_AVERAGE_WEIGHT;
+	}
+
+	if (clean)
+		l->cleanWrites += n;
+	else
+		l->cleanWrites = 0;
+
+	if (n && results[n - 1])
+		l->lastAck = timestamp();
+
+	l->retries += retries;
+	l->meanRetries += (retries - l->meanRetries) / LINK_AVERAGE_WEIGHT;
+
+	if (n)
+		l->roundTrip += ((double) rf->getWriteTime() / n - l->roundTrip) / LINK_AVERAGE_WEIGHT;
+
+	if (lost)
+	{
+		l->lost += lost;
+		rf->resetLostCount();
+	}
+
+	receiveTelemetry(hand);
+
+	/* Back off further on a noisy channel, but keep the worst case of
+	 * one payload within the retry budget */
+	if (l->meanRetries < 0.5)
+		l->retryDelay = 0;
+	else if (l->meanRetries < 2)
+		l->retryDelay = 1;
+	else
+		l->retryDelay = 3;
+
+	l->retryCount = std::min(15, LINK_RETRY_BUDGET / ((l->retryDelay + 1) * 250));
+}
+
+/**
+ * Read the telemetry returned with the last write
+ *
+ * @param hand 	0 for right hand, 1 for left hand
+ */
+void RadioService::receiveTelemetry(int hand)
+{
+	LinkStats *l = &link[hand];
+	unsigned char frame[MAX_PAYLOAD_SIZE];
+
+	while (rf->isAckPayloadAvailable())
+	{
+		int len = rf->readAckPayload(frame, sizeof(frame));
+
+		if (len < TELEMETRY_SIZE || frame[0] != TELEMETRY)
+			continue;
+
+		/* A jump back means the module has restarted */
+		unsigned char missed = frame[2] - l->reportedMissed;
+		if (l->reportedMissed >= 0 && missed < 128)
+			l->missed += missed;
+
+		l->reportedMissed = frame[2];
+		l->battery = frame[3] * 0.02;
+		l->motors = frame[4] | ((frame[5] & 0x03) << 8);
+		l->lastTelemetry = timestamp();
+		l->telemetry++;
+	}
+}
+
+/**
+ * Ask a hand module to change data rate
+ *
+ * @param  hand 	0 for right hand, 1 for left hand
+ * @param  rate 	new data rate
+ * @return      	true if the module acknowledged
+ */
+bool RadioService::configureLink(int hand, DataRate rate)
+{
+	unsigned char frame[PACKED_FEEDBACK_SIZE] = {LINK_CONFIG, 0, 0, 0, 0};
+
+	frame[1] = rate == RF_DR_2MBPS ? 1 : 0;
+
+	rf->beginTransaction();
+	rf->openWritingPipe(hand ? LEFT_HAND_ADDRESS : RIGHT_HAND_ADDRESS);
+
+	return rf->write(frame, PACKED_FEEDBACK_SIZE);
+}
+
+/**
+ * Ask a hand module to change RF channel
+ *
+ * @param  hand 	0 for right hand, 1 for left hand
+ * @param  target 	new channel
+ * @return      	true if the module acknowledged
+ */
+bool RadioService::hopChannel(int hand, int target)
+{
+	unsigned char frame[PACKED_FEEDBACK_SIZE] = {CHANNEL_HOP, 0, 0, 0, 0};
+
+	frame[1] = target;
+
+	rf->beginTransaction();
+	rf->openWritingPipe(hand ? LEFT_HAND_ADDRESS : RIGHT_HAND_ADDRESS);
+
+	return rf->write(frame, PACKED_FEEDBACK_SIZE);
+}
+
+/**
+ * Look for a hand module on a channel it was asked to hop to
+ *
+ * The hop frame is sent again on the target channel, where the module
+ * ignores it if it is already there. The radio stays on the link channel
+ * of the hand if nothing answers.
+ *
+ * @param  hand 	0 for right hand, 1 for left hand
+ * @param  target 	hop channel
+ * @return      	true if the module answered on the target channel
+ */
+bool RadioService::probeChannel(int hand, int target)
+{
+	rf->setChannel(target);
+
+	if (hopChannel(hand, target))
+		return true;
+
+	rf->setChannel(link[hand].channel);
+
+	return false;
+}
+
+/**
+ * Update statistics of a sent command
+ *
+ * @param command 	feedback command
+ * @param success 	true if the command was acknowledged
+ */
+void RadioService::account(FeedbackCommand *command, bool success)
+{
+	if (success)
+		sent++;
+	else
+		failed++;
+
+	long long latency = timestamp() - command->queuedAt;
+	totalLatency += latency;
+
+	if (latency > maxLatency)
+		maxLatency = latency;
+}
+
+/**
+ * Enqueue feedback command
+ *
+ * This method never blocks. Must only be called from one thread.
+ *
+ * @param  hand    	0 for right hand, 1 for left hand
+ * @param  payload 	payload to send
+ * @param  len     	payload length
+ * @return         	false if the command was dropped
+ */
+bool RadioService::send(int hand, const unsigned char *payload, int len)
+{
+	FeedbackCommand command;
+
+	command.hand = hand ? 1 : 0;
+	command.length = len > MAX_FEEDBACK_PAYLOAD ? MAX_FEEDBACK_PAYLOAD : len;
+	memcpy(command.payload, payload, command.length);
+	command.queuedAt = timestamp();
+
+	if (!queue.push(command))
+	{
+		dropped++;
+		return false;
+	}
+
+	sem_post(&pending);
+
+	return true;
+}
+
+/**
+ * Enqueue vibrator command
+ *
+ * In packed mode the whole mask goes out in one payload, in legacy
+ * mode every motor gets its own one byte command.
+ *
+ * @param  hand      	0 for right hand, 1 for left hand
+ * @param  motors    	vibrator mask, bit n for motor n
+ * @param  on        	turn the vibrators on or off
+ * @param  duration  	on time in 10 ms units, 0 for the module default
+ * @param  intensity 	vibration strength, 0 for full power
+ * @return           	false if a command was dropped
+ */
+bool RadioService::sendMotors(int hand, unsigned short motors, bool on, unsigned char duration, unsigned char intensity)
+{
+	if (legacy)
+	{
+		bool result = true;
+
+		for (int i = 0; i < MOTOR_COUNT; i++)
+		{
+			if (!(motors & (1 << i)))
+				continue;
+
+			unsigned char payload = (on ? MOTOR_ON : MOTOR_OFF) | i;
+			result = send(hand, &payload, LEGACY_FEEDBACK_SIZE) && result;
+		}
+
+		return result;
+	}
+
+	unsigned char payload[SEQUENCED_FEEDBACK_SIZE];
+
+	payload[0] = PACKED_FEEDBACK;
+	payload[1] = motors & 0xFF;
+	payload[2] = ((motors >> 8) & 0x03) | (on ? PACKED_SET : 0);
+	payload[3] = duration;
+	payload[4] = intensity;
+	payload[5] = 0;
+
+	return send(hand, payload, SEQUENCED_FEEDBACK_SIZE);
+}
+
+/**
+ * Enqueue vibrator command for both hands
+ *
+ * In packed mode the command goes out once to the broadcast address,
+ * without waiting for an acknowledgement. In legacy mode each hand gets
+ * its own commands.
+ *
+ * @param  motors    	vibrator mask, bit n for motor n
+ * @param  on        	turn the vibrators on or off
+ * @param  duration  	on time in 10 ms units, 0 for the module default
+ * @param  intensity 	vibration strength, 0 for full power
+ * @return           	false if a command was dropped
+ */
+bool RadioService::broadcastMotors(unsigned short motors, bool on, unsigned char duration, unsigned char intensity)
+{
+	if (legacy)
+	{
+		bool result = true;
+
+		for (int hand = 0; hand < 2; hand++)
+		{
+			if (!on && motors == ALL_MOTORS)
+			{
+				unsigned char payload = ALL_MOTOR_OFF;
+				result = send(hand, &payload, LEGACY_FEEDBACK_SIZE) && result;
+			}
+			else
+				result = sendMotors(hand, motors, on, duration, intensity) && result;
+		}
+
+		return result;
+	}
+
+	FeedbackCommand command;
+
+	/* Without a sequence number, the modules do not track broadcasts */
+	command.hand = BROADCAST;
+	command.length = PACKED_FEEDBACK_SIZE;
+	command.payload[0] = PACKED_FEEDBACK;
+	command.payload[1] = motors & 0xFF;
+	command.payload[2] = ((motors >> 8) & 0x03) | (on ? PACKED_SET : 0);
+	command.payload[3] = duration;
+	command.payload[4] = intensity;
+	command.queuedAt = timestamp();
+
+	if (!queue.push(command))
+	{
+		dropped++;
+		return false;
+	}
+
+	sem_post(&pending);
+
+	return true;
+}
+
+/**
+ * Use one byte commands
+ *
+ * Old firmware has no sequence numbers to drop duplicates, so bursts
+ * keep one payload in flight and are never resent blindly. Must be set
+ * before the worker starts.
+ *
+ * @param enable 	true for hand modules without packed support
+ */
+void RadioService::setLegacyProtocol(bool enable)
+{
+	legacy = enable;
+	rf->setBurstDepth(enable ? 1 : TX_FIFO_DEPTH);
+}
+
+/**
+ * Set RF channel of the hand modules
+ *
+ * The modules start on HOME_CHANNEL and are moved to this channel
+ * before their next command. Needs the packed protocol. Must be set
+ * before the worker starts.
+ *
+ * @param target 	channel number
+ */
+void RadioService::setChannel(int target)
+{
+	channel = std::max(0, std::min(target, RF_CHANNELS - 1));
+}
+
+/**
+ * Get payload size of the feedback protocol
+ *
+ * @return  payload size in bytes
+ */
+int RadioService::getPayloadSize(void)
+{
+	return legacy ? LEGACY_FEEDBACK_SIZE : SEQUENCED_FEEDBACK_SIZE;
+}
+
+/**
+ * Begin radio power session
+ *
+ * Lets the radio stay in Standby-I between commands until endSession(),
+ * and gives both hands a short start cue in packed mode.
+ */
+void RadioService::beginSession(void)
+{
+	session = true;
+
+	if (!legacy)
+		broadcastMotors(ALL_MOTORS, true, SESSION_CUE_DURATION);
+
+	sem_post(&pending);
+}
+
+/**
+ * End radio power session
+ *
+ * Turns off every motor of both hands.
+ */
+void RadioService::endSession(void)
+{
+	broadcastMotors(ALL_MOTORS, false);
+	session = false;
+	sem_post(&pending);
+}
+
+/**
+ * Get radio transceiver handler
+ *
+ * Only use it while the worker is stopped.
+ *
+ * @return  radio handler
+ */
+ORF24 *RadioService::getRadio(void)
+{
+	return rf;
+}
+
+/**
+ * Get monotonic timestamp
+ *
+ * @return  time in microseconds
+ */
+long long RadioService::timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * Get current queue depth
+ *
+ * @return  number of queued commands
+ */
+unsigned int RadioService::getQueueDepth(void)
+{
+	return queue.size();
+}
+
+/**
+ * Get maximum queue depth
+ *
+ * @return  deepest queue seen
+ */
+unsigned int RadioService::getMaxQueueDepth(void)
+{
+	return maxDepth;
+}
+
+/**
+ * Get sent command count
+ *
+ * @return  number of acknowledged commands
+ */
+unsigned long RadioService::getSentCount(void)
+{
+	return sent;
+}
+
+/**
+ * Get failed command count
+ *
+ * @return  number of commands that were not acknowledged
+ */
+unsigned long RadioService::getFailedCount(void)
+{
+	return failed;
+}
+
+/**
+ * Get dropped command count
+ *
+ * @return  number of commands dropped on a full queue
+ */
+unsigned long RadioService::getDroppedCount(void)
+{
+	return dropped;
+}
+
+/**
+ * Get maximum command latency
+ *
+ * @return  latency in microseconds
+ */
+long long RadioService::getMaxLatency(void)
+{
+	return maxLatency;
+}
+
+/**
+ * Get mean command latency
+ *
+ * @return  latency in microseconds
+ */
+double RadioService::getMeanLatency(void)
+{
+	unsigned long count = sent + failed;
+
+	return count ? (double) totalLatency / count : 0;
+}
+
+/**
+ * Wait until every queued command is sent
+ *
+ * The worker then copies the link statistics for getLinkStats().
+ */
+void RadioService::drain(void)
+{
+	runWhenDrained(0);
+}
+
+/**
+ * Get link quality of a hand module
+ *
+ * Returns the copy taken by the last drain().
+ *
+ * @param  hand 	0 for right hand, 1 for left hand
+ * @return      	link statistics
+ */
+LinkStats RadioService::getLinkStats(int hand)
+{
+	std::lock_guard<std::mutex> lock(drainMutex);
+
+	return linkSnapshot[hand ? 1 : 0];
+}
+
+/**
+ * Reset counters
+ *
+ * Waits for the queued commands, the link counters are cleared by the
+ * worker. The link policy is kept, the modules may still be listening
+ * at 2 Mbps.
+ */
+void RadioService::resetStatistics(void)
+{
+	runWhenDrained(DRAIN_RESET);
+
+	sent = 0;
+	failed = 0;
+	dropped = 0;
+	maxDepth = 0;
+	maxLatency = 0;
+	totalLatency = 0;
+}
+
+/**
+ * Print radio statistics
+ *
+ * Waits for the queued commands, so the report includes them.
+ */
+void RadioService::printStatistics(void)
+{
+	drain();
+
+	std::cout << "Radio: " << sent << " sent, "
+			  << failed << " failed, "
+			  << dropped << " dropped, "
+			  << "max depth " << maxDepth << ", "
+			  << "max latency " << maxLatency << " us, "
+			  << "mean latency " << getMeanLatency() << " us" << std::endl;
+
+	for (int hand = 0; hand < 2; hand++)
+	{
+		LinkStats stats = getLinkStats(hand);
+		LinkStats *l = &stats;
+
+		std::cout << (hand ? "Left" : "Right") << " hand link: "
+				  << l->acked << " acked, "
+				  << l->failed << " failed, "
+				  << l->retries << " retries, "
+				  << l->lost << " lost, "
+				  << "success " << l->successRate * 100 << " %, "
+				  << "round trip " << l->roundTrip << " us, "
+				  << (l->rate == RF_DR_2MBPS ? "2" : "1") << " Mbps, "
+				  << "channel " << l->channel << ", "
+				  << "ARD " << (l->retryDelay + 1) * 250 << " us, "
+				  << "ARC " << l->retryCount << std::endl;
+
+		if (l->telemetry)
+			std::cout << (hand ? "Left" : "Right") << " hand module: "
+					  << l->telemetry << " reports, "
+					  << l->missed << " missed, "
+					  << "battery " << l->battery << " V, "
+					  << "motors 0x" << std::hex << l->motors << std::dec << std::endl;
+	}
+
+	runWhenDrained(DRAIN_PRINT_RADIO);
+}
@@ -271,19 +271,110 @@ void MidiApi :: error( RtMidiError::Type type, std::string errorString )
 //  Common MidiInApi Definitions
 //*********************************************************************//
 
+void MidiInApi::MidiQueue :: allocate( unsigned int size )
+{
+  ringSize = size;
+  front.store( 0 );
+  back.store( 0 );
+  sysexFront.store( 0 );
+  sysexBack = 0;
+  if ( ringSize > 0 ) {
+    ring = new Slot[ ringSize + 1 ];
+    sysexRing = new std::vector<unsigned char>[ SYSEX_RING_SIZE + 1 ];
+    for ( unsigned int i=0; i<=SYSEX_RING_SIZE; i++ )
+      sysexRing[i].reserve( SYSEX_RESERVE );
+  }
+}
+
+void MidiInApi::MidiQueue :: release( void )
+{
+  if ( ring ) delete [] ring;
+  if ( sysexRing ) delete [] sysexRing;
+  ring = 0;
+  sysexRing = 0;
+  ringSize = 0;
+}
+
+unsigned int MidiInApi::MidiQueue :: count( void )
+{
+  unsigned int f = front.load( std::memory_order_acquire );
+  unsigned int b = back.load( std::memory_order_acquire );
+  return ( b >= f ) ? b - f : b + ringSize + 1 - f;
+}
+
+// Called only from the input thread.
+bool MidiInApi::MidiQueue :: push( const MidiMessage &message )
+{
+  if ( ringSize == 0 ) return false;
+
+  unsigned int b = back.load( std::memory_order_relaxed );
+  unsigned int next = ( b == ringSize ) ? 0 : b + 1;
+  if ( next == front.load( std::memory_order_acquire ) ) {
+    overflows.fetch_add( 1, std::memory_order_relaxed );
+    return false;
+  }
+
+  Slot &slot = ring[b];
+  slot.timeStamp = message.timeStamp;
+  slot.size = message.bytes.size();
+
+  if ( slot.size <= INLINE_SIZE ) {
+    for ( unsigned int i=0; i<slot.size; i++ )
+      slot.bytes[i] = message.bytes[i];
+  }
+  else {
+    unsigned int nextSysex = ( sysexBack == SYSEX_RING_SIZE ) ? 0 : sysexBack + 1;
+    if ( nextSysex == sysexFront.load( std::memory_order_acquire ) ) {
+      sysexOverflows.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+    sysexRing[sysexBack].assign( message.bytes.begin(), message.bytes.end() );
+    sysexBack = nextSysex;
+  }
+
+  back.store( next, std::memory_order_release );
+  return true;
+}
+
+// Called only from the getMessage() thread.
+bool MidiInApi::MidiQueue :: pop( std::vector<unsigned char> *message, double *timeStamp )
+{
+  unsigned int f = front.load( std::memory_order_relaxed );
+  if ( f == back.load( std::memory_order_acquire ) ) return false;
+
+  Slot &slot = ring[f];
+  *timeStamp = slot.timeStamp;
+
+  if ( slot.size <= INLINE_SIZE )
+    message->assign( slot.bytes, slot.bytes + slot.size );
+  else {
+    unsigned int s = sysexFront.load( std::memory_order_relaxed );
+    message->assign( sysexRing[s].begin(), sysexRing[s].end() );
+    sysexFront.store( ( s == SYSEX_RING_SIZE ) ? 0 : s + 1, std::memory_order_release );
+  }
+
+  front.store( ( f == ringSize ) ? 0 : f + 1, std::memory_order_release );
+  return true;
+}
+
+bool MidiInApi::RtMidiInData :: enqueue( const MidiMessage &message )
+{
+  if ( !queue.push( message ) ) return false;
+  if ( notifier ) notifier( notifierData );
+  return true;
+}
+
 MidiInApi :: MidiInApi( unsigned int queueSizeLimit )
   : MidiApi()
 {
   // Allocate the MIDI queue.
-  inputData_.queue.ringSize = queueSizeLimit;
-  if ( inputData_.queue.ringSize > 0 )
-    inputData_.queue.ring = new MidiMessage[ inputData_.queue.ringSize ];
+  inputData_.queue.allocate( queueSizeLimit );
 }
 
 MidiInApi :: ~MidiInApi( void )
 {
   // Delete the MIDI queue.
-  if ( inputData_.queue.ringSize > 0 ) delete [] inputData_.queue.ring;
+  inputData_.queue.release();
 }
 
 void MidiInApi :: setCallback( RtMidiIn::RtMidiCallback callback, void *userData )
@@ -318,6 +409,39 @@ void MidiInApi :: cancelCallback()
   inputData_.usingCallback = false;
 }
 
+void MidiInApi :: setQueueNotifier( RtMidiIn::RtMidiNotifier notifier, void *userData )
+{
+  inputData_.notifierData = userData;
+  inputData_.notifier = notifier;
+}
+
+void MidiInApi :: setQueueSizeLimit( unsigned int queueSizeLimit )
+{
+  if ( connected_ ) {
+    errorString_ = "MidiInApi::setQueueSizeLimit: the queue cannot be resized while a port is open.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.queue.release();
+  inputData_.queue.allocate( queueSizeLimit );
+}
+
+unsigned int MidiInApi :: getQueueCount( void )
+{
+  return inputData_.queue.count();
+}
+
+unsigned long MidiInApi :: getQueueOverflowCount( void )
+{
+  return inputData_.queue.overflows.load( std::memory_order_relaxed );
+}
+
+unsigned long MidiInApi :: getSysexOverflowCount( void )
+{
+  return inputData_.queue.sysexOverflows.load( std::memory_order_relaxed );
+}
+
 void MidiInApi :: ignoreTypes( bool midiSysex, bool midiTime, bool midiSense )
 {
   inputData_.ignoreFlags = 0;
@@ -336,16 +460,9 @@ double MidiInApi :: getMessage( std::vector<unsigned char> *message )
     return 0.0;
   }
 
-  if ( inputData_.queue.size == 0 ) return 0.0;
-
   // Copy queued message to the vector pointer argument and then "pop" it.
-  std::vector<unsigned char> *bytes = &(inputData_.queue.ring[inputData_.queue.front].bytes);
-  message->assign( bytes->begin(), bytes->end() );
-  double deltaTime = inputData_.queue.ring[inputData_.queue.front].timeStamp;
-  inputData_.queue.size--;
-  inputData_.queue.front++;
-  if ( inputData_.queue.front == inputData_.queue.ringSize )
-    inputData_.queue.front = 0;
+  double deltaTime = 0.0;
+  if ( !inputData_.queue.pop( message, &deltaTime ) ) return 0.0;
 
   return deltaTime;
 }
@@ -363,6 +480,51 @@ MidiOutApi :: ~MidiOutApi( void )
 {
 }
 
+void MidiOutApi :: sendMessage( const unsigned char *message, size_t size )
+{
+  // Backends without a raw path go through the vector interface.
+  std::vector<unsigned char> bytes( message, message + size );
+  sendMessage( &bytes );
+}
+
+void MidiOutApi :: sendMessages( const unsigned char *messages, const size_t *sizes, size_t count )
+{
+  for ( size_t i=0; i<count; ++i ) {
+    sendMessage( messages, sizes[i] );
+    messages += sizes[i];
+  }
+}
+
+bool MidiOutApi :: startQueue( double /*tempoScale*/ )
+{
+  errorString_ = "MidiOutApi::startQueue: scheduled output is not supported by this API.";
+  error( RtMidiError::WARNING, errorString_ );
+  return false;
+}
+
+void MidiOutApi :: setQueueTempo( double /*tempoScale*/ )
+{
+}
+
+void MidiOutApi :: scheduleMessages( const unsigned char *messages, const size_t *sizes, size_t count, unsigned int /*tick*/ )
+{
+  // Without a queue the best we can do is to send right away.
+  sendMessages( messages, sizes, count );
+}
+
+unsigned int MidiOutApi :: getQueueTime( void )
+{
+  return 0;
+}
+
+void MidiOutApi :: syncQueue( void )
+{
+}
+
+void MidiOutApi :: stopQueue( void )
+{
+}
+
 // *************************************************** //
 //
 // OS/API-specific methods.
@@ -463,13 +625,7 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
         }
         else {
           // As long as we haven't reached our queue size limit, push the message.
-          if ( data->queue.size < data->queue.ringSize ) {
-            data->queue.ring[data->queue.back++] = message;
-            if ( data->queue.back == data->queue.ringSize )
-              data->queue.back = 0;
-            data->queue.size++;
-          }
-          else
+          if ( !data->enqueue( message ) )
             std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
         }
         message.bytes.clear();
@@ -527,13 +683,7 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
             }
             else {
               // As long as we haven't reached our queue size limit, push the message.
-              if ( data->queue.size < data->queue.ringSize ) {
-                data->queue.ring[data->queue.back++] = message;
-                if ( data->queue.back == data->queue.ringSize )
-                  data->queue.back = 0;
-                data->queue.size++;
-              }
-              else
+              if ( !data->enqueue( message ) )
                 std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
             }
             message.bytes.clear();
@@ -1084,7 +1234,6 @@ struct AlsaMidiData {
   snd_seq_port_subscribe_t *subscription;
   snd_midi_event_t *coder;
   unsigned int bufferSize;
-  unsigned char *buffer;
   pthread_t thread;
   pthread_t dummy_thread_id;
   unsigned long long lastTime;
@@ -1273,13 +1422,7 @@ static void *alsaMidiHandler( void *ptr )
     }
     else {
       // As long as we haven't reached our queue size limit, push the message.
-      if ( data->queue.size < data->queue.ringSize ) {
-        data->queue.ring[data->queue.back++] = message;
-        if ( data->queue.back == data->queue.ringSize )
-          data->queue.back = 0;
-        data->queue.size++;
-      }
-      else
+      if ( !data->enqueue( message ) )
         std::cerr << "\nMidiInAlsa: message queue limit reached!!\n\n";
     }
   }
@@ -1653,7 +1796,7 @@ MidiOutAlsa :: ~MidiOutAlsa()
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
   if ( data->vport >= 0 ) snd_seq_delete_port( data->seq, data->vport );
   if ( data->coder ) snd_midi_event_free( data->coder );
-  if ( data->buffer ) free( data->buffer );
+  if ( data->queue_id >= 0 ) snd_seq_free_queue( data->seq, data->queue_id );
   snd_seq_close( data->seq );
   delete data;
 }
@@ -1679,7 +1822,7 @@ void MidiOutAlsa :: initialize( const std::string& clientName )
   data->vport = -1;
   data->bufferSize = 32;
   data->coder = 0;
-  data->buffer = 0;
+  data->queue_id = -1;
   int result = snd_midi_event_new( data->bufferSize, &data->coder );
   if ( result < 0 ) {
     delete data;
@@ -1687,13 +1830,6 @@ void MidiOutAlsa :: initialize( const std::string& clientName )
     error( RtMidiError::DRIVER_ERROR, errorString_ );
     return;
   }
-  data->buffer = (unsigned char *) malloc( data->bufferSize );
-  if ( data->buffer == NULL ) {
-    delete data;
-    errorString_ = "MidiOutAlsa::initialize: error allocating buffer memory!\n\n";
-    error( RtMidiError::MEMORY_ERROR, errorString_ );
-    return;
-  }
   snd_midi_event_init( data->coder );
   apiData_ = (void *) data;
 }
@@ -1826,48 +1962,168 @@ void MidiOutAlsa :: openVirtualPort( std::string portName )
 }
 
 void MidiOutAlsa :: sendMessage( std::vector<unsigned char> *message )
+{
+  if ( message->empty() ) return;
+  sendMessage( &message->at(0), message->size() );
+}
+
+void MidiOutAlsa :: sendMessage( const unsigned char *message, size_t size )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( encodeMessage( message, size ) )
+    snd_seq_drain_output( data->seq );
+}
+
+void MidiOutAlsa :: sendMessages( const unsigned char *messages, const size_t *sizes, size_t count )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  bool pending = false;
+  for ( size_t i=0; i<count; ++i ) {
+    pending |= encodeMessage( messages, sizes[i] );
+    messages += sizes[i];
+  }
+
+  // One drain for the whole batch.
+  if ( pending ) snd_seq_drain_output( data->seq );
+}
+
+// Scheduling queue resolution.  With a tempo of RTMIDI_QUEUE_PPQ
+// microseconds per quarter note, one tick lasts one microsecond.
+#define RTMIDI_QUEUE_PPQ 1000
+
+bool MidiOutAlsa :: startQueue( double tempoScale )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( !connected_ ) {
+    errorString_ = "MidiOutAlsa::startQueue: no open output port!";
+    error( RtMidiError::WARNING, errorString_ );
+    return false;
+  }
+
+  if ( data->queue_id < 0 ) {
+    data->queue_id = snd_seq_alloc_named_queue( data->seq, "RtMidi Output Queue" );
+    if ( data->queue_id < 0 ) {
+      errorString_ = "MidiOutAlsa::startQueue: ALSA error allocating output queue.";
+      error( RtMidiError::DRIVER_ERROR, errorString_ );
+      return false;
+    }
+  }
+
+  setQueueTempo( tempoScale );
+  snd_seq_start_queue( data->seq, data->queue_id, NULL );
+  snd_seq_drain_output( data->seq );
+  return true;
+}
+
+void MidiOutAlsa :: setQueueTempo( double tempoScale )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->queue_id < 0 ) return;
+
+  unsigned int tempo = (unsigned int) ( tempoScale * RTMIDI_QUEUE_PPQ + 0.5 );
+  if ( tempo < 1 ) tempo = 1;
+
+  snd_seq_queue_tempo_t *qtempo;
+  snd_seq_queue_tempo_alloca( &qtempo );
+  snd_seq_queue_tempo_set_tempo( qtempo, tempo );
+  snd_seq_queue_tempo_set_ppq( qtempo, RTMIDI_QUEUE_PPQ );
+  snd_seq_set_queue_tempo( data->seq, data->queue_id, qtempo );
+  snd_seq_drain_output( data->seq );
+}
+
+void MidiOutAlsa :: scheduleMessages( const unsigned char *messages, const size_t *sizes, size_t count, unsigned int tick )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->queue_id < 0 ) {
+    errorString_ = "MidiOutAlsa::scheduleMessages: the output queue is not running!";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  bool pending = false;
+  for ( size_t i=0; i<count; ++i ) {
+    pending |= encodeMessage( messages, sizes[i], true, tick );
+    messages += sizes[i];
+  }
+
+  if ( pending ) snd_seq_drain_output( data->seq );
+}
+
+unsigned int MidiOutAlsa :: getQueueTime( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->queue_id < 0 ) return 0;
+
+  snd_seq_queue_status_t *status;
+  snd_seq_queue_status_alloca( &status );
+  if ( snd_seq_get_queue_status( data->seq, data->queue_id, status ) < 0 ) return 0;
+  return snd_seq_queue_status_get_tick_time( status );
+}
+
+void MidiOutAlsa :: syncQueue( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->queue_id < 0 ) return;
+
+  // Returns once the kernel has dispatched everything this client queued.
+  snd_seq_drain_output( data->seq );
+  snd_seq_sync_output_queue( data->seq );
+}
+
+void MidiOutAlsa :: stopQueue( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->queue_id < 0 ) return;
+
+  // Freeing the queue also removes the events it still holds.
+  snd_seq_drop_output( data->seq );
+  snd_seq_stop_queue( data->seq, data->queue_id, NULL );
+  snd_seq_drain_output( data->seq );
+  snd_seq_free_queue( data->seq, data->queue_id );
+  data->queue_id = -1;
+}
+
+bool MidiOutAlsa :: encodeMessage( const unsigned char *message, size_t size, bool scheduled, unsigned int tick )
 {
   int result;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
-  unsigned int nBytes = message->size();
+  unsigned int nBytes = size;
   if ( nBytes > data->bufferSize ) {
     data->bufferSize = nBytes;
     result = snd_midi_event_resize_buffer ( data->coder, nBytes);
     if ( result != 0 ) {
       errorString_ = "MidiOutAlsa::sendMessage: ALSA error resizing MIDI event buffer.";
       error( RtMidiError::DRIVER_ERROR, errorString_ );
-      return;
-    }
-    free (data->buffer);
-    data->buffer = (unsigned char *) malloc( data->bufferSize );
-    if ( data->buffer == NULL ) {
-    errorString_ = "MidiOutAlsa::initialize: error allocating buffer memory!\n\n";
-    error( RtMidiError::MEMORY_ERROR, errorString_ );
-    return;
+      return false;
     }
   }
 
+  // The encoder reads the caller's bytes directly, no copy is needed.
   snd_seq_event_t ev;
   snd_seq_ev_clear(&ev);
   snd_seq_ev_set_source(&ev, data->vport);
   snd_seq_ev_set_subs(&ev);
-  snd_seq_ev_set_direct(&ev);
-  for ( unsigned int i=0; i<nBytes; ++i ) data->buffer[i] = message->at(i);
-  result = snd_midi_event_encode( data->coder, data->buffer, (long)nBytes, &ev );
+  result = snd_midi_event_encode( data->coder, message, (long)nBytes, &ev );
   if ( result < (int)nBytes ) {
     errorString_ = "MidiOutAlsa::sendMessage: event parsing error!";
     error( RtMidiError::WARNING, errorString_ );
-    return;
+    return false;
   }
 
-  // Send the event.
+  if ( scheduled )
+    snd_seq_ev_schedule_tick( &ev, data->queue_id, 0, tick );
+  else
+    snd_seq_ev_set_direct( &ev );
+
+  // Queue the event in the output buffer, the caller drains it.
   result = snd_seq_event_output(data->seq, &ev);
   if ( result < 0 ) {
     errorString_ = "MidiOutAlsa::sendMessage: error sending MIDI message to port.";
     error( RtMidiError::WARNING, errorString_ );
-    return;
+    return false;
   }
-  snd_seq_drain_output(data->seq);
+
+  return true;
 }
 
 #endif // __LINUX_ALSA__
@@ -1996,13 +2252,7 @@ static void CALLBACK midiInputCallback( HMIDIIN /*hmin*/,
   }
   else {
     // As long as we haven't reached our queue size limit, push the message.
-    if ( data->queue.size < data->queue.ringSize ) {
-      data->queue.ring[data->queue.back++] = apiData->message;
-      if ( data->queue.back == data->queue.ringSize )
-        data->queue.back = 0;
-      data->queue.size++;
-    }
-    else
+    if ( !data->enqueue( apiData->message ) )
       std::cerr << "\nRtMidiIn: message queue limit reached!!\n\n";
   }
 
@@ -2472,13 +2722,7 @@ static int jackProcessIn( jack_nframes_t nframes, void *arg )
       }
       else {
         // As long as we haven't reached our queue size limit, push the message.
-        if ( rtData->queue.size < rtData->queue.ringSize ) {
-          rtData->queue.ring[rtData->queue.back++] = message;
-          if ( rtData->queue.back == rtData->queue.ringSize )
-            rtData->queue.back = 0;
-          rtData->queue.size++;
-        }
-        else
+        if ( !rtData->enqueue( message ) )
           std::cerr << "\nMidiInJack: message queue limit reached!!\n\n";
       }
     }
@@ -0,0 +1,192 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "Scheduler.h"
+
+/**
+ * Scheduler Class Constructor
+ */
+Scheduler::Scheduler()
+{
+	start();
+}
+
+/**
+ * Start Session Clock
+ *
+ * Set the session origin to the current time and reset the statistics
+ */
+void Scheduler::start(void)
+{
+	start(0);
+}
+
+/**
+ * Start Session Clock at a Given Time
+ *
+ * Set the session origin so that the given time has already elapsed,
+ * to share the origin of another clock
+ *
+ * @param elapsed 	session time in microseconds
+ */
+void Scheduler::start(long long elapsed)
+{
+	clock_gettime(CLOCK_MONOTONIC, &origin);
+
+	long long nsec = origin.tv_nsec - (elapsed % 1000000) * 1000;
+	origin.tv_sec -= elapsed / 1000000;
+
+	if (nsec < 0)
+	{
+		nsec += 1000000000;
+		origin.tv_sec--;
+	}
+
+	origin.tv_nsec = nsec;
+
+	events = 0;
+	lateEvents = 0;
+	maxLateness = 0;
+	totalLateness = 0;
+}
+
+/**
+ * Get Session Time
+ *
+ * @return  microseconds elapsed since the session origin
+ */
+long long Scheduler::now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec - origin.tv_sec) * 1000000LL + (ts.tv_nsec - origin.tv_nsec) / 1000;
+}
+
+/**
+ * Get Monotonic Time
+ *
+ * @param  offset 	offset in microseconds from the session origin
+ * @return        	CLOCK_MONOTONIC time in microseconds
+ */
+long long Scheduler::getMonotonicTime(long long offset)
+{
+	return origin.tv_sec * 1000000LL + origin.tv_nsec / 1000 + offset;
+}
+
+/**
+ * Wait Until Deadline
+ *
+ * Sleep until the given offset from the session origin has passed.
+ *
+ * @param  deadline 	deadline in microseconds from the session origin
+ * @return          	lateness in microseconds
+ */
+long long Scheduler::waitUntil(long long deadline)
+{
+	struct timespec ts;
+	long long nsec = origin.tv_nsec + (deadline % 1000000) * 1000;
+
+	ts.tv_sec = origin.tv_sec + deadline / 1000000 + nsec / 1000000000;
+	ts.tv_nsec = nsec % 1000000000;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+	long long lateness = now() - deadline;
+	lateness = lateness > 0 ? lateness : 0;
+
+	events++;
+	totalLateness += lateness;
+
+	if (lateness > 1000)
+		lateEvents++;
+
+	if (lateness > maxLateness)
+		maxLateness = lateness;
+
+	return lateness;
+}
+
+/**
+ * Get Event Count
+ *
+ * @return  number of events waited for
+ */
+long Scheduler::getEventCount(void)
+{
+	return events;
+}
+
+/**
+ * Get Late Event Count
+ *
+ * An event is counted as late when it starts more than a millisecond
+ * after its deadline.
+ *
+ * @return  number of events that missed their deadline
+ */
+long Scheduler::getLateEventCount(void)
+{
+	return lateEvents;
+}
+
+/**
+ * Get Maximum Lateness
+ *
+ * @return  maximum lateness in microseconds
+ */
+long long Scheduler::getMaxLateness(void)
+{
+	return maxLateness;
+}
+
+/**
+ * Get Mean Lateness
+ *
+ * @return  mean lateness in microseconds
+ */
+double Scheduler::getMeanLateness(void)
+{
+	return events ? (double) totalLateness / events : 0;
+}
+
+/**
+ * Print Timing Statistics
+ */
+void Scheduler::printStatistics(void)
+{
+	std::cout << "Timing: " << events << " events, "
+			  << lateEvents << " late, "
+			  << "max lateness " << maxLateness << " us, "
+			  << "mean lateness " << getMeanLateness() << " us" << std::endl;
+}
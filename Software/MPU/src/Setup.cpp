@@ -47,12 +47,26 @@ struct Args getArgs(int argc, char *argv[])
 	TCLAP::CmdLine cmd("Arjuna: Piano Learning Device For The Visually Impaired", ' ', "1.0.0.alpha-1");
 	TCLAP::SwitchArg enableDebugSwitch("d", "debug", "Show debug information.", cmd, false);
 	TCLAP::SwitchArg enableKeyboardSwitch("k", "keyboard", "Enable keyboard input.", cmd, false);
+	TCLAP::SwitchArg enableQueueSwitch("q", "queue", "Let the ALSA sequencer queue time the playback.", cmd, false);
+	TCLAP::SwitchArg legacyFeedbackSwitch("l", "legacy-feedback", "Send one byte feedback commands for old hand module firmware.", cmd, false);
+	TCLAP::ValueArg<int> radioIdleArg("s", "standby", "Milliseconds the radio stays in standby after a command during a song. 0 powers down after every command.", false, 2000, "ms", cmd);
+	TCLAP::ValueArg<int> radioChannelArg("c", "channel", "RF channel for the hand modules. The quietest channel is surveyed at startup if not set.", false, -1, "channel", cmd);
+	TCLAP::ValueArg<int> radioIRQArg("i", "irq", "WiringPi pin of the radio IRQ line. The radio is polled if not set.", false, -1, "pin", cmd);
+	TCLAP::ValueArg<int> radioCEArg("e", "ce", "WiringPi pin of the radio CE line.", false, 21, "pin", cmd);
+	TCLAP::ValueArg<std::string> keypadRowArg("r", "rows", "WiringPi pins of the keypad rows, comma separated. A row shared with the radio CE keeps the keypad polled.", false, "21,22,23,24", "pins", cmd);
 
 	cmd.parse(argc, argv);
 
 	struct Args parsedArgs;
 	parsedArgs.debugEnabled = enableDebugSwitch.getValue();
 	parsedArgs.keyboardEnabled = enableKeyboardSwitch.getValue();
+	parsedArgs.queueEnabled = enableQueueSwitch.getValue();
+	parsedArgs.radioIRQPin = radioIRQArg.getValue();
+	parsedArgs.radioCEPin = radioCEArg.getValue();
+	parsedArgs.keypadRowPins = keypadRowArg.getValue();
+	parsedArgs.radioIdleTimeout = radioIdleArg.getValue();
+	parsedArgs.radioChannel = radioChannelArg.getValue();
+	parsedArgs.legacyFeedback = legacyFeedbackSwitch.getValue();
 
 	return parsedArgs;
 }
@@ -87,7 +101,15 @@ int initHardware(struct Container *container, struct Args *args)
 		return -1;
 	}
 
-	if (keypadSetup(container, args))
+	if (args->keyboardEnabled)
+	{
+		if (keyboardSetup(container, args))
+		{
+			std::cout << "Failed to set up keyboard." << std::endl;
+			return -1;
+		}
+	}
+	else if (keypadSetup(container, args))
 	{
 		std::cout << "Failed to set up keypad." << std::endl;
 		return -1;
@@ -110,6 +132,7 @@ int midiIOSetup(struct Container *container, struct Args *args)
 	MidiIO *io = container->io;
 
 	io->enableDebug(args->debugEnabled);
+	io->enableQueue(args->queueEnabled);
 
 	return 0;
 }
@@ -124,18 +147,65 @@ int radioSetup(struct Container *container, struct Args *args)
 	if (args->debugEnabled)
 		std::cout << "Setting up radio transceiver..." << std::endl;
 
-	container->rf = new ORF24(21);
+	container->rf = new ORF24(args->radioCEPin);
 	ORF24 *rf = container->rf;
 
 	if (args->debugEnabled)
 		rf->enableDebug();
 
 	rf->begin();
-	rf->setPayloadSize(1);
-	rf->setChannel(76);
+
+	if (!rf->enableGpioChip(GPIO_CHIP) && args->debugEnabled)
+		std::cout << "Failed to request radio CE from " GPIO_CHIP ", using wiringPi." << std::endl;
+
+	rf->setPayloadSize(args->legacyFeedback ? LEGACY_FEEDBACK_SIZE : PACKED_FEEDBACK_SIZE);
+	rf->setChannel(HOME_CHANNEL);
 	rf->setCRCLength(CRC_2_BYTE);
 	rf->setPowerLevel(RF_PA_HIGH);
 
+	/* Hand modules report their state in the ACK of every command, and
+	 * share a broadcast address for cues that need no ACK */
+	if (!args->legacyFeedback)
+	{
+		rf->enableAckPayload();
+		rf->enableDynamicAck();
+	}
+
+	if (args->radioIdleTimeout > 0)
+		rf->setPowerPolicy(STANDBY_IN_SESSION, args->radioIdleTimeout);
+	else
+		rf->setPowerPolicy(POWER_DOWN_AFTER_WRITE, 0);
+
+	if (args->radioIRQPin >= 0 && !rf->enableIRQ(args->radioIRQPin))
+		std::cout << "Failed to set up radio IRQ, polling instead." << std::endl;
+
+	/* Old hand module firmware cannot leave the home channel */
+	int channel = HOME_CHANNEL;
+
+	if (!args->legacyFeedback)
+	{
+		if (args->radioChannel >= 0)
+		{
+			channel = args->radioChannel;
+		}
+		else
+		{
+			int histogram[RF_CHANNELS];
+
+			rf->scanChannels(histogram, CHANNEL_SURVEY_SWEEPS);
+			channel = ORF24::getQuietestChannel(histogram, HOME_CHANNEL);
+
+			if (args->debugEnabled)
+				std::cout << "Quietest RF channel is " << channel << ", busy in "
+						  << histogram[channel] << " of " << CHANNEL_SURVEY_SWEEPS << " samples." << std::endl;
+		}
+	}
+
+	container->radio = new RadioService(rf);
+	container->radio->setLegacyProtocol(args->legacyFeedback);
+	container->radio->setChannel(channel);
+	container->radio->start();
+
 	return 0;
 }
 
@@ -149,8 +219,18 @@ int keypadSetup(struct Container *container, struct Args *args)
 	if (args->debugEnabled)
 		std::cout << "Setting up keypad matrix..." << std::endl;
 
-	int row[4] = {21, 22, 23, 24};
+	int row[4];
 	int column[4] = {1, 2, 3, 4};
+	bool sharedCE = false;
+
+	if (!parsePinList(args->keypadRowPins, row, 4))
+	{
+		std::cout << "Keypad needs four row pins." << std::endl;
+		return -1;
+	}
+
+	for (int i = 0; i < 4; i++)
+		sharedCE = sharedCE || row[i] == args->radioCEPin;
 	std::vector<std::vector<char>> matrix {
 		{'D', 'C', 'B', 'A'},
 		{'#', '9', '6', '3'},
@@ -158,12 +238,83 @@ int keypadSetup(struct Container *container, struct Args *args)
 		{'*', '7', '4', '1'}
 	};
 
-	container->keypad = new WiringPiKeypad(4, 4);
-	WiringPiKeypad *keypad = container->keypad;
+	WiringPiKeypad *keypad = new WiringPiKeypad(4, 4);
+	container->keypad = keypad;
 
 	keypad->setRowPin(row);
 	keypad->setColumnPin(column);
 	keypad->setMatrix(matrix);
+	keypad->begin();
+
+	/* Edge scanning holds every row low while idle, which would hold a
+	 * shared CE low in the middle of a radio write */
+	if (sharedCE)
+		std::cout << "Keypad row shares the radio CE pin, polling the keypad." << std::endl;
+	else if (keypad->enableGpioChip(GPIO_CHIP) || keypad->enableEdgeScan())
+		keypad->setDebounceDelay(30);
+	else
+		std::cout << "Failed to set up keypad interrupts, polling instead." << std::endl;
+
+	container->input = new InputService(keypad);
+	container->input->start();
+
+	return 0;
+}
+
+/**
+ * Parse a comma separated pin list
+ * 
+ * @param  list 	pin list
+ * @param  pins 	pin container
+ * @param  count 	number of pins expected
+ * @return       	true if exactly count pins were read
+ */
+bool parsePinList(std::string list, int *pins, int count)
+{
+	std::stringstream stream(list);
+	std::string item;
+	int n = 0;
+
+	while (std::getline(stream, item, ','))
+	{
+		if (n == count || item.empty() || item.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+
+		pins[n++] = std::stoi(item);
+	}
+
+	return n == count;
+}
+
+/**
+ * Setup keyboard
+ *
+ * A USB numpad or keyboard replaces the keypad matrix. Digits and A-D map
+ * to themselves, the numpad operators map to A-D, dot to '*' and enter
+ * to '#'.
+ * 
+ * @return  status
+ */
+int keyboardSetup(struct Container *container, struct Args *args)
+{
+	if (args->debugEnabled)
+		std::cout << "Setting up keyboard..." << std::endl;
+
+	EvdevKeypad *keyboard = new EvdevKeypad();
+
+	if (!keyboard->begin())
+	{
+		std::cout << "No keyboard found in " EVDEV_DIR "." << std::endl;
+		delete keyboard;
+		return -1;
+	}
+
+	if (args->debugEnabled)
+		keyboard->printDetails();
+
+	container->keypad = keyboard;
+	container->input = new InputService(keyboard);
+	container->input->start();
 
 	return 0;
 }
\ No newline at end of file
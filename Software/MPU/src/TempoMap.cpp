@@ -0,0 +1,163 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include "TempoMap.h"
+
+/**
+ * TempoMap Class Constructor
+ */
+TempoMap::TempoMap() : tpq(120)
+{
+	segments.push_back({0, 0, DEFAULT_TEMPO});
+}
+
+/**
+ * Build Tempo Map
+ *
+ * @param midi 	MIDI file handler
+ */
+void TempoMap::build(MidiFile *midi)
+{
+	std::vector<TempoSegment> changes;
+
+	tpq = midi->getTicksPerQuarterNote();
+	tpq = tpq > 0 ? tpq : 120;
+
+	for (int t = 0; t < midi->getTrackCount(); t++)
+	{
+		long tick = 0;
+
+		for (int e = 0; e < (*midi)[t].getSize(); e++)
+		{
+			MidiEvent &event = midi->getEvent(t, e);
+
+			if (midi->isDeltaTicks())
+				tick += event.tick;
+			else
+				tick = event.tick;
+
+			if (event.isTempo())
+				changes.push_back({tick, 0, event.getTempoMicroseconds()});
+		}
+	}
+
+	std::stable_sort(changes.begin(), changes.end(),
+		[](const TempoSegment &a, const TempoSegment &b) { return a.tick < b.tick; });
+
+	segments.clear();
+	segments.push_back({0, 0, DEFAULT_TEMPO});
+
+	for (unsigned int i = 0; i < changes.size(); i++)
+	{
+		TempoSegment segment = changes[i];
+		segment.time = toMicroseconds(segments.size() - 1, segment.tick);
+
+		if (segment.tick == segments.back().tick)
+			segments.back() = segment;
+		else
+			segments.push_back(segment);
+	}
+}
+
+/**
+ * Convert tick inside a segment to microseconds
+ *
+ * @param  s    	segment index
+ * @param  tick 	absolute tick
+ * @return      	time in microseconds
+ */
+long long TempoMap::toMicroseconds(int s, long tick)
+{
+	const TempoSegment &segment = segments[s];
+
+	return segment.time + (long long) (tick - segment.tick) * segment.tempo / tpq;
+}
+
+/**
+ * Get Time of Tick
+ *
+ * Look the segment up with a binary search.
+ *
+ * @param  tick 	absolute tick
+ * @return      	time in microseconds
+ */
+long long TempoMap::getMicroseconds(long tick)
+{
+	int low = 0;
+	int high = segments.size() - 1;
+
+	while (low < high)
+	{
+		int mid = (low + high + 1) / 2;
+
+		if (segments[mid].tick <= tick)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	return toMicroseconds(low, tick);
+}
+
+/**
+ * Get Time of Tick Using Cursor
+ *
+ * The cursor remembers the last segment, so walking the song forward
+ * costs O(1) per lookup. Start with a cursor of 0.
+ *
+ * @param  tick   	absolute tick
+ * @param  cursor 	segment cursor
+ * @return        	time in microseconds
+ */
+long long TempoMap::getMicroseconds(long tick, int *cursor)
+{
+	int last = segments.size() - 1;
+
+	if (*cursor > last || segments[*cursor].tick > tick)
+		*cursor = 0;
+
+	while (*cursor < last && segments[*cursor + 1].tick <= tick)
+		*cursor += 1;
+
+	return toMicroseconds(*cursor, tick);
+}
+
+/**
+ * Get Segment Count
+ *
+ * @return  number of tempo segments
+ */
+int TempoMap::getSegmentCount(void)
+{
+	return segments.size();
+}
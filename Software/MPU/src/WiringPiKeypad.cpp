@@ -25,6 +25,8 @@
 
 #include "WiringPiKeypad.h"
 
+WiringPiKeypad *WiringPiKeypad::edgeInstance = NULL;
+
 /**
  * Class constructor
  */
@@ -81,6 +83,420 @@ void WiringPiKeypad::setMatrix(std::vector<std::vector<char>> m)
 	matrix = m;
 }
 
+/**
+ * Configure keypad pins
+ *
+ * Columns are pulled up and rows are left floating. This only has to be
+ * done once, the scanners only switch row direction.
+ */
+void WiringPiKeypad::begin(void)
+{
+	for (int i = 0; i < columnSize; i++)
+	{
+		pinMode(columnPin[i], INPUT);
+		pullUpDnControl(columnPin[i], PUD_UP);
+	}
+
+	for (int i = 0; i < rowSize; i++)
+	{
+		pinMode(rowPin[i], INPUT);
+		pullUpDnControl(rowPin[i], PUD_OFF);
+	}
+}
+
+/**
+ * Enable edge triggered scanning
+ *
+ * All rows are held low while idle, so any keypress pulls its column
+ * low. Column edges are watched by wiringPi ISRs and the matrix is only
+ * scanned after an edge. Only one keypad instance can use edge scanning.
+ * 
+ * @return  status
+ */
+bool WiringPiKeypad::enableEdgeScan(void)
+{
+	edgeInstance = this;
+
+	for (int i = 0; i < columnSize; i++)
+	{
+		if (wiringPiISR(columnPin[i], INT_EDGE_BOTH, &WiringPiKeypad::edgeHandler) < 0)
+		{
+			edgeInstance = NULL;
+			return false;
+		}
+	}
+
+	armRows();
+	edgeScan = true;
+
+	return true;
+}
+
+/**
+ * Check edge triggered scanning
+ * 
+ * @return  true if edge scanning is enabled
+ */
+bool WiringPiKeypad::isEdgeScanEnabled(void)
+{
+	return edgeScan;
+}
+
+/**
+ * Enable scanning through the GPIO character device
+ *
+ * Rows are requested as open drain outputs, so a row set high floats and
+ * the whole row pattern is written with one ioctl. Columns are requested
+ * as pulled up inputs with edge events, read with one ioctl and watched
+ * through the request instead of wiringPi ISRs. Replaces enableEdgeScan().
+ * 
+ * @param  chip 	GPIO chip device
+ * @return      	status
+ */
+bool WiringPiKeypad::enableGpioChip(const char *chip)
+{
+	int rows[MAX_GPIO_LINES];
+	int columns[MAX_GPIO_LINES];
+
+	if (rowSize > MAX_GPIO_LINES || columnSize > MAX_GPIO_LINES)
+		return false;
+
+	for (int i = 0; i < rowSize; i++)
+		rows[i] = wpiPinToGpio(rowPin[i]);
+
+	for (int i = 0; i < columnSize; i++)
+		columns[i] = wpiPinToGpio(columnPin[i]);
+
+	if (!columnLines.requestInput(chip, columns, columnSize, true, true))
+		return false;
+
+	/* All rows start low, armed for the first keypress */
+	if (!rowLines.requestOutput(chip, rows, rowSize, true, 0))
+	{
+		columnLines.release();
+		return false;
+	}
+
+	edgeScan = true;
+
+	return true;
+}
+
+/**
+ * Check GPIO character device scanning
+ * 
+ * @return  true if the keypad lines are requested from the GPIO chip
+ */
+bool WiringPiKeypad::isGpioChipEnabled(void)
+{
+	return rowLines.isOpen() && columnLines.isOpen();
+}
+
+/**
+ * Drive every row low to wait for a keypress
+ */
+void WiringPiKeypad::armRows(void)
+{
+	if (isGpioChipEnabled())
+	{
+		rowLines.setValues(0, (1ULL << rowSize) - 1);
+		return;
+	}
+
+	for (int i = 0; i < rowSize; i++)
+	{
+		pinMode(rowPin[i], OUTPUT);
+		digitalWrite(rowPin[i], LOW);
+	}
+}
+
+/**
+ * Scan the matrix once
+ *
+ * Only the scanned row is driven, the others float so two keys in one
+ * column never short two outputs. Without diodes a third key can ghost,
+ * so only the first max keys are reported.
+ *
+ * @param  keys 	pressed keys container
+ * @param  max  	maximum number of keys to report
+ * @return      	number of pressed keys
+ */
+int WiringPiKeypad::scan(struct key *keys, int max)
+{
+	int count = 0;
+
+	if (isGpioChipEnabled())
+		return scanLines(keys, max);
+
+	for (int i = 0; i < rowSize; i++)
+	{
+		pinMode(rowPin[i], INPUT);
+	}
+
+	for (int i = 0; i < rowSize && count < max; i++)
+	{
+		pinMode(rowPin[i], OUTPUT);
+		digitalWrite(rowPin[i], LOW);
+		delayMicroseconds(SCAN_SETTLE_DELAY);
+
+		for (int j = 0; j < columnSize && count < max; j++)
+		{
+			if (! digitalRead(columnPin[j]))
+			{
+				keys[count].row = i;
+				keys[count].column = j;
+				count++;
+			}
+		}
+
+		pinMode(rowPin[i], INPUT);
+	}
+
+	/* A polled keypad leaves its rows floating between scans */
+	if (edgeScan)
+		armRows();
+
+	return count;
+}
+
+/**
+ * Scan the matrix once through the GPIO character device
+ *
+ * Each row costs one ioctl to float the other rows and one to read every
+ * column. Edges raised by the scan itself are dropped afterwards.
+ * 
+ * @param  keys 	pressed keys container
+ * @param  max  	maximum number of keys to report
+ * @return      	number of pressed keys
+ */
+int WiringPiKeypad::scanLines(struct key *keys, int max)
+{
+	unsigned long long rows = (1ULL << rowSize) - 1;
+	int count = 0;
+
+	for (int i = 0; i < rowSize && count < max; i++)
+	{
+		unsigned long long columns;
+
+		rowLines.setValues(rows & ~(1ULL << i), rows);
+		delayMicroseconds(SCAN_SETTLE_DELAY);
+
+		if (!columnLines.getValues(&columns))
+			break;
+
+		for (int j = 0; j < columnSize && count < max; j++)
+		{
+			if (!(columns & (1ULL << j)))
+			{
+				keys[count].row = i;
+				keys[count].column = j;
+				count++;
+			}
+		}
+	}
+
+	armRows();
+	columnLines.waitEdges(0, NULL);
+
+	return count;
+}
+
+/**
+ * Wait for a column edge
+ *
+ * Sleeps on the GPIO line request when the keypad uses the GPIO chip, on
+ * the wiringPi ISR signal otherwise. The lock is released while waiting.
+ * 
+ * @param  lock    	held edge lock
+ * @param  timeout 	timeout in milliseconds
+ * @return         	true if an unseen edge arrived
+ */
+bool WiringPiKeypad::waitEdge(std::unique_lock<std::mutex> &lock, int timeout)
+{
+	if (isGpioChipEnabled())
+	{
+		long long time = 0;
+
+		lock.unlock();
+		int edges = columnLines.waitEdges(timeout, &time);
+		lock.lock();
+
+		if (edges > 0)
+		{
+			edgeCount += edges;
+			lastEdge = millis();
+			lastEdgeTime = time;
+		}
+
+		return edgeCount != edgeSeen;
+	}
+
+	return edgeSignal.wait_for(lock, std::chrono::milliseconds(timeout),
+		[this] { return edgeCount != edgeSeen; });
+}
+
+/**
+ * Get key symbol
+ * 
+ * @param  k 	key position
+ * @return   	symbol from the keypad matrix
+ */
+char WiringPiKeypad::getSymbol(struct key k)
+{
+	return matrix[k.row][k.column];
+}
+
+/**
+ * Wait for a key event with edge triggered scanning
+ *
+ * A press is reported on its first edge. Edges of a held key only count
+ * once they have been quiet for the debounce delay, so bouncing never
+ * blocks the caller and never reports a key twice. While a key is held the
+ * wait also wakes up for long press and repeat deadlines.
+ *
+ * @param  event 		event container
+ * @param  terminator 	keep waiting while true
+ * @return            	false if the terminator stopped the wait
+ */
+bool WiringPiKeypad::getEdgeEvent(struct KeyEvent *event, const std::atomic<bool> *terminator)
+{
+	struct key keys[MAX_HELD_KEYS];
+	std::unique_lock<std::mutex> lock(edgeMutex);
+
+	while (*terminator)
+	{
+		int timeout = pollingDelay;
+
+		if (edgePending)
+		{
+			int quiet = millis() - lastEdge;
+			timeout = held.row < 0 || quiet >= debounceDelay ? 0 : debounceDelay - quiet;
+		}
+		else
+		{
+			int gesture = getGestureTimeout();
+			timeout = gesture >= 0 && gesture < timeout ? gesture : timeout;
+		}
+
+		if (waitEdge(lock, timeout))
+		{
+			edgeSeen = edgeCount;
+			edgePending = true;
+		}
+
+		if (!edgePending)
+		{
+			if (checkGesture(event))
+				return true;
+
+			if (held.row < 0)
+				continue;
+
+			/* A key sharing the held key's column raises no edge, so
+			 * look for chords at the polling rate while a key is down */
+		}
+
+		/* A held key waits for its contacts to settle */
+		if (held.row >= 0 && (int) (millis() - lastEdge) < debounceDelay)
+			continue;
+
+		long long time = edgePending ? lastEdgeTime : timestamp();
+
+		lock.unlock();
+		int count = scan(keys, MAX_HELD_KEYS);
+		lock.lock();
+
+		/* Row switching during the scan raises edges of its own */
+		edgeSeen = edgeCount;
+		edgePending = false;
+
+		if (updateKeys(keys, count, time, event))
+		{
+			/* One scan can hold more than one change, look again */
+			edgePending = true;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Wait for a key event by polling the matrix
+ *
+ * @param  event 		event container
+ * @param  terminator 	keep waiting while true
+ * @return            	false if the terminator stopped the wait
+ */
+bool WiringPiKeypad::getPolledEvent(struct KeyEvent *event, const std::atomic<bool> *terminator)
+{
+	struct key keys[MAX_HELD_KEYS];
+
+	while (*terminator)
+	{
+		int quiet = millis() - lastChange;
+
+		if (quiet < debounceDelay)
+			delay(debounceDelay - quiet);
+
+		int count = scan(keys, MAX_HELD_KEYS);
+
+		if (updateKeys(keys, count, timestamp(), event))
+		{
+			lastChange = millis();
+
+			return true;
+		}
+
+		if (checkGesture(event))
+			return true;
+
+		delay(pollingDelay);
+	}
+
+	return false;
+}
+
+/**
+ * Wait for a key event
+ *
+ * @param  event 		event container
+ * @param  terminator 	keep waiting while true
+ * @return            	false if the terminator stopped the wait
+ */
+bool WiringPiKeypad::getEvent(struct KeyEvent *event, const std::atomic<bool> *terminator)
+{
+	if (edgeScan)
+		return getEdgeEvent(event, terminator);
+
+	return getPolledEvent(event, terminator);
+}
+
+/**
+ * Handle column edge
+ */
+void WiringPiKeypad::onEdge(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(edgeMutex);
+		edgeCount++;
+		lastEdge = millis();
+		lastEdgeTime = timestamp();
+	}
+
+	edgeSignal.notify_all();
+}
+
+/**
+ * Column edge service routine registered with wiringPi
+ */
+void WiringPiKeypad::edgeHandler(void)
+{
+	if (edgeInstance)
+		edgeInstance->onEdge();
+}
+
 /**
  * Set debounce delay
  * 
@@ -128,7 +544,7 @@ int WiringPiKeypad::getPollingDelay(void)
  */
 struct key WiringPiKeypad::getRawKey(void)
 {
-	bool terminator = true;
+	std::atomic<bool> terminator(true);
 	return getRawKey(&terminator);
 }
 
@@ -137,20 +553,24 @@ struct key WiringPiKeypad::getRawKey(void)
  * 
  * @return  key structure
  */
-struct key WiringPiKeypad::getRawKey(bool *terminator)
+struct key WiringPiKeypad::getRawKey(const std::atomic<bool> *terminator)
 {
 	struct key k;
 
-	for (int i = 0; i < columnSize; i++)
+	if (edgeScan)
 	{
-		pinMode(columnPin[i], INPUT);
-		pullUpDnControl(columnPin[i], PUD_UP);
-	}
+		struct KeyEvent event;
 
-	for (int i = 0; i < rowSize; i++)
-	{
-		pinMode(rowPin[i], INPUT);
-		pullUpDnControl(rowPin[i], PUD_OFF);
+		while (getEdgeEvent(&event, terminator))
+		{
+			if (event.type == KEYPAD_DOWN)
+				return event.position;
+		}
+
+		k.row = 0;
+		k.column = 0;
+
+		return k;
 	}
 
 	while (*terminator)
@@ -164,6 +584,7 @@ struct key WiringPiKeypad::getRawKey(bool *terminator)
 			{
 				if (! digitalRead(columnPin[j]))
 				{
+					pinMode(rowPin[i], INPUT);
 					delay(debounceDelay);
 					k.row = i;
 					k.column = j;
@@ -173,7 +594,6 @@ struct key WiringPiKeypad::getRawKey(bool *terminator)
 			}
 
 			pinMode(rowPin[i], INPUT);
-			pullUpDnControl(rowPin[i], PUD_OFF);
 
 			delay(pollingDelay);
 		}
@@ -189,7 +609,7 @@ struct key WiringPiKeypad::getRawKey(bool *terminator)
  */
 char WiringPiKeypad::getKey(void)
 {
-	bool terminator = true;
+	std::atomic<bool> terminator(true);
 	struct key k = getRawKey(&terminator);
 
 	return matrix[k.row][k.column];
@@ -200,7 +620,7 @@ char WiringPiKeypad::getKey(void)
  * 
  * @return  pressed key
  */
-char WiringPiKeypad::getKey(bool *terminator)
+char WiringPiKeypad::getKey(const std::atomic<bool> *terminator)
 {
 	struct key k = getRawKey(terminator);
 
@@ -261,4 +681,8 @@ void WiringPiKeypad::printDetails(void)
 
 	std::cout << "Debounce delay:\t" << debounceDelay << std::endl;
 	std::cout << "Polling delay:\t" << pollingDelay << std::endl;
+	std::cout << "Long press:\t" << longPressDelay << std::endl;
+	std::cout << "Repeat:\t\t" << repeatInterval << std::endl;
+	std::cout << "Edge scan:\t" << (edgeScan ? "enabled" : "disabled") << std::endl;
+	std::cout << "GPIO chip:\t" << (isGpioChipEnabled() ? "enabled" : "disabled") << std::endl;
 }
\ No newline at end of file
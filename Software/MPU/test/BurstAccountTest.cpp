@@ -0,0 +1,199 @@
+/**
+ * Arjuna: Alat Bantu Pembelajaran Piano untuk Tunanetra
+ *
+ * Developed by:
+ * Ilham Imaduddin
+ * Ahmad Shalahuddin
+ * Piquitha Della Audyna
+ *
+ * Elektronika dan Instrumentasi
+ * Universitas Gadjah Mada
+ * 
+ * Copyright (c) 2015 Arjuna
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ */
+
+#include <iostream>
+#include <deque>
+#include <vector>
+
+#include "BurstAccount.h"
+
+#define		PAYLOADS		6
+#define		FIFO_DEPTH		3
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { if (!(condition)) { std::cout << "  failed: " #condition " (line " << __LINE__ << ")\n"; failures++; } } while (0)
+
+/**
+ * Simulated nRF24L01+ transmitter
+ *
+ * Sends the FIFO head once per tick. TX_DS and MAX_RT are sticky until
+ * cleared, and a payload that reaches the retry limit stays at the head
+ * until the FIFO is flushed.
+ */
+struct Radio
+{
+	std::deque<int> fifo;
+	std::vector<int> attempts;
+	std::vector<int> delivered;
+	std::vector<int> failsBeforeAck;	/* -1 never acks */
+	bool txDS = false;
+	bool maxRT = false;
+
+	Radio(std::vector<int> fails) : attempts(PAYLOADS, 0), delivered(PAYLOADS, 0), failsBeforeAck(fails) { }
+
+	void tick(int n)
+	{
+		for (int i = 0; i < n && !fifo.empty() && !maxRT; i++)
+		{
+			int p = fifo.front();
+
+			if (failsBeforeAck[p] < 0 || attempts[p]++ < failsBeforeAck[p])
+			{
+				maxRT = true;
+			}
+			else
+			{
+				delivered[p]++;
+				fifo.pop_front();
+				txDS = true;
+			}
+		}
+	}
+};
+
+/**
+ * Run one burst the way ORF24::writeBurst() does
+ *
+ * @param radio 	simulated radio
+ * @param depth 	burst depth
+ * @param merge 	payloads sent between two polls
+ * @param results 	per payload acknowledgement
+ * @return      	acknowledged payloads
+ */
+static int runBurst(Radio *radio, int depth, int merge, bool *results)
+{
+	BurstAccount burst(PAYLOADS, results, depth);
+
+	while (burst.canLoad())
+		radio->fifo.push_back(burst.next());
+
+	for (int polls = 0; !burst.isDone() && polls < 1000; polls++)
+	{
+		radio->tick(merge);
+
+		if (radio->txDS)
+		{
+			radio->txDS = false;
+			burst.onSent();
+		}
+
+		if (radio->maxRT)
+		{
+			radio->maxRT = false;
+			radio->fifo.clear();
+			burst.onFailed();
+			continue;
+		}
+
+		while (burst.canLoad())
+			radio->fifo.push_back(burst.next());
+
+		if (burst.inFlight() && radio->fifo.empty())
+			burst.onEmpty();
+	}
+
+	burst.finish();
+
+	return burst.getAcked();
+}
+
+/**
+ * Every result must match what the receiver got
+ */
+static void checkResults(Radio *radio, bool *results)
+{
+	for (int i = 0; i < PAYLOADS; i++)
+		CHECK(results[i] == (radio->delivered[i] > 0));
+}
+
+int main(void)
+{
+	bool results[PAYLOADS];
+
+	std::cout << "Merged TX_DS before MAX_RT\n";
+	{
+		/* Payload 0 and 1 are acked in the same poll that payload 2 fails */
+		Radio radio({0, 0, 1, 0, 0, 0});
+		int acked = runBurst(&radio, FIFO_DEPTH, 3, results);
+
+		checkResults(&radio, results);
+		CHECK(acked == PAYLOADS);
+	}
+
+	std::cout << "Payload that never gets through\n";
+	{
+		Radio radio({0, 0, -1, 0, 0, 0});
+		int acked = runBurst(&radio, FIFO_DEPTH, 3, results);
+
+		checkResults(&radio, results);
+		CHECK(acked == PAYLOADS - 1);
+		CHECK(!results[2]);
+	}
+
+	std::cout << "TX_DS and MAX_RT in one poll\n";
+	{
+		Radio radio({0, -1, 0, 0, 0, 0});
+		runBurst(&radio, FIFO_DEPTH, 2, results);
+
+		checkResults(&radio, results);
+		CHECK(results[0] && !results[1]);
+	}
+
+	std::cout << "One payload in flight is exact\n";
+	{
+		Radio radio({0, 0, -1, 0, 0, 0});
+		runBurst(&radio, 1, 3, results);
+
+		checkResults(&radio, results);
+
+		for (int i = 0; i < PAYLOADS; i++)
+			CHECK(radio.delivered[i] <= 1);
+	}
+
+	std::cout << "One poll per payload needs no resend\n";
+	{
+		Radio radio({0, 0, -1, 0, 0, 0});
+		runBurst(&radio, FIFO_DEPTH, 1, results);
+
+		checkResults(&radio, results);
+
+		for (int i = 0; i < PAYLOADS; i++)
+			CHECK(radio.delivered[i] <= 1);
+	}
+
+	std::cout << (failures ? "FAILED\n" : "OK\n");
+
+	return failures ? 1 : 0;
+}